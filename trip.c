@@ -1,16 +1,153 @@
 // ----- The Bus Trip -----
 
+#define _GNU_SOURCE  // fopencookie
 #include <stdio.h>  // I/O
 #include <stdlib.h>  // Memory
 #include <string.h>  // String Operations
 #include <time.h>  // Date/Time
 #include <unistd.h>  // CLI Input Bug
+#include <pthread.h>  // Parallel Loading
+#include <errno.h>  // Lock Results
+#include <limits.h>  // Unreached Cities
+#include <fcntl.h>  // Shared Store File
+#include <signal.h>  // Finding Stopped Counters
+#include <sys/file.h>  // Shared Store Setup Lock
+#include <sys/mman.h>  // Shared Memory
+#include <sys/stat.h>  // Shared Store Size
+#include <sys/socket.h>  // Standby Replication
+#include <sys/un.h>  // Replication Socket Path
+#include <poll.h>  // Waiting for Input or Changes
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>  // SIMD Delimiter Scanning
+#endif
 
 // Maximum limits
 #define MAX_TRIPS 100
 #define MAX_TICKETS 500
 #define MAX_SEATS 50
 #define MAX_STRING 100
+#define MAX_STOPS 8 // Departure, up to 6 intermediate stops, arrival
+
+// Seat bitmaps keep one bit per seat in a 64-bit word
+#if MAX_SEATS > 64
+#error "MAX_SEATS must fit in a 64-bit seat bitmap"
+#endif
+
+// Loader tuning
+#define MAX_LOADER_THREADS 8
+#define LOADER_MIN_CHUNK 4096 // Bytes per thread before splitting pays off
+#define MAX_FIELDS 16 // Fields kept per record line
+#define MAX_REPORTED_ERRORS 10 // Malformed lines reported individually
+
+// Record parse results
+#define RECORD_BLANK 0
+#define RECORD_OK 1
+#define RECORD_TRUNCATED 2 // Loaded, but a text field was cut to MAX_STRING
+#define RECORD_BAD_FIELD_COUNT -1
+#define RECORD_BAD_NUMBER -2
+
+// Seat holds
+#define MAX_HOLDS 200
+#define DEFAULT_HOLD_MINUTES 10
+#define MAX_HOLD_MINUTES 120
+#define WHEEL_BITS 6 // 64 slots per wheel level
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 3 // 1 second ticks, covers 64^3 seconds
+
+// Waitlist capacity (all trips together)
+#define MAX_WAITLIST 200
+
+// Multi-counter mode (--shared)
+#define MAX_COUNTERS 8 // Ticket windows sharing one store
+#define SHARED_STORE_FILE "store.shm"
+#define SHARED_STORE_MAGIC 0x42555354u // "BUST"
+#define SHARED_LOG_SIZE 1024 // Changed slots a counter can fall behind before indexing everything again
+#define CHANGE_TRIP 1
+#define CHANGE_TICKET 2
+#define CHANGE_TEMPLATE 3
+#define SAVE_TRIPS 1
+#define SAVE_TICKETS 2
+#define SAVE_TEMPLATES 4
+#define SAVE_WAITLIST 8
+
+// Bus and driver schedules
+#define SCHEDULE_HASH_SIZE 256 // Buckets for bus plates and driver names
+#define DEFAULT_TRIP_MINUTES 240 // Assumed length of trips saved without an arrival time
+#define MINUTES_PER_DAY 1440
+
+// Journey planner
+#define MAX_CITIES (MAX_TRIPS * 2) // Each active trip adds at most two
+#define CITY_HASH_SIZE 256
+#define MAX_JOURNEY_LEGS 4
+#define JOURNEY_DAYS 3 // Days from the travel date whose recurring trips are searched
+#define DEFAULT_TRANSFER_MINUTES 30
+
+// Recurring trips
+#define MAX_TEMPLATES 20
+#define RECURRING_ID_BASE 100000 // Instance ID = base + template ID * 1000 + day offset
+#define RECURRING_MAX_DAYS 1000 // Day offsets fit in the last three digits
+#define UPCOMING_INSTANCES 7 // Dates listed per template
+
+// Primary/standby replication
+#define REPLICA_NONE 0
+#define REPLICA_PRIMARY 1
+#define REPLICA_STANDBY 2
+#define REPLICA_RETRY_MS 1000 // A standby without a primary tries to reconnect this often
+#define REPLICA_SEND_TIMEOUT 2 // Seconds before a stalled standby is dropped
+#define REPLICA_READ_SIZE 65536 // Bytes a standby takes from the socket per read
+#define REPLICA_ARCHIVE_CHUNK 4096 // Archive bytes per line, sent as hex
+#define PROMOTE_CHOICE 18
+
+// Cold archive of departed trips
+#define ARCHIVE_FILE "archive.dat"
+#define ARCHIVE_MAGIC 0x48435241u // "ARCH"
+#define ARCHIVE_BLOCK_SIZE 65536 // Raw bytes gathered before a block is compressed
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 4 // Shorter matches cost as much as the literals
+#define LZ_MAX_MATCH 131 // Match lengths fit in 7 bits
+#define LZ_MAX_LITERALS 128 // Literal runs fit in 7 bits
+#define LZ_WINDOW 65535 // Match distances fit in 16 bits
+
+// Operation capture and replay
+#define OPLOG_MAGIC 0x474C504Fu // "OPLG"
+#define OPLOG_VERSION 2
+#define OPLOG_FILE_NAME 32
+#define OPERATION_KINDS 20 // Menu choices 0-18, the last slot counts invalid ones
+
+// Report groupings
+#define GROUP_BY_ROUTE 1
+#define GROUP_BY_DATE 2
+#define GROUP_BY_WEEKDAY 3
+#define GROUP_BY_DRIVER 4
+#define GROUP_NAME_LENGTH (MAX_STRING * 2 + 8) // Fits "From -> To"
+
+// Hash index sizes (powers of two)
+#define TRIP_HASH_SIZE 256
+#define TICKET_HASH_SIZE 1024
+#define PASSENGER_HASH_SIZE 1024
+#define ARCHIVE_HASH_SIZE 1024
+#define PHONE_KEY_DIGITS 10 // Digits in a national phone number (5XX XXX XX XX)
+
+// Name search
+#define MAX_FOLDED (MAX_STRING * 2) // Case folding can widen I to two-byte ı
+#define NAME_SEARCH_LIMIT 10
+
+// Trip update journal
+#define TRIP_JOURNAL_FILE "trips.journal"
+#define MAX_JOURNAL_RECORDS 256 // trips.txt is rewritten once the journal is this long
+#define FIELD_DEPARTURE_POINT 0x001 // Fields of a trip change set
+#define FIELD_ARRIVAL_POINT 0x002
+#define FIELD_TRIP_DATE 0x004
+#define FIELD_DEPARTURE_TIME 0x008
+#define FIELD_BUS 0x010
+#define FIELD_DRIVER 0x020
+#define FIELD_SEATS 0x040
+#define FIELD_PRICE 0x080
+#define FIELD_STOPS 0x100
+#define FIELD_ARRIVAL_TIME 0x200
+#define FIELD_SCHEDULE (FIELD_TRIP_DATE | FIELD_DEPARTURE_TIME | FIELD_ARRIVAL_TIME | FIELD_BUS | FIELD_DRIVER)
+#define FIELD_CONNECTION (FIELD_DEPARTURE_POINT | FIELD_ARRIVAL_POINT | FIELD_TRIP_DATE | FIELD_DEPARTURE_TIME | \
+                          FIELD_ARRIVAL_TIME)
 
 // Trip structure
 typedef struct {
@@ -25,6 +162,8 @@ typedef struct {
     int availableSeats;
     float ticketPrice;
     int isActive; // 1 if trip exists, 0 if deleted
+    char stops[MAX_STRING]; // Intermediate stops in order, comma separated
+    char arrivalTime[MAX_STRING]; // HH:MM (next day if not after departure), may be empty
 } Trip;
 
 // Passenger structure
@@ -44,13 +183,380 @@ typedef struct {
     float price;
     char purchaseDate[MAX_STRING];
     int isActive; // 1 if ticket is valid, 0 if cancelled
+    int fromStop; // Boarding stop (0 = departure point)
+    int toStop; // Leaving stop (last = arrival point)
+    int boarded; // 1 once scanned at the gate
 } Ticket;
 
-// Global arrays to store data
-Trip trips[MAX_TRIPS];
-Ticket tickets[MAX_TICKETS];
+// One journaled trip update: the changed fields and the trip after the change
+typedef struct {
+    int mask; // FIELD_* bits
+    Trip trip;
+} TripChange;
+
+// A trip run on chosen weekdays between two dates. Its instances become
+// real trips only when one is first looked up.
+typedef struct {
+    int templateID;
+    char departurePoint[MAX_STRING];
+    char arrivalPoint[MAX_STRING];
+    char stops[MAX_STRING];
+    char departureTime[MAX_STRING];
+    char arrivalTime[MAX_STRING];
+    char busLicensePlate[MAX_STRING];
+    char driverName[MAX_STRING];
+    int totalSeats;
+    float ticketPrice;
+    int weekdays; // Bit 0 = Monday ... bit 6 = Sunday
+    char firstDate[MAX_STRING];
+    char lastDate[MAX_STRING];
+    int isActive; // 0 once stopped; instances made before stay
+} TripTemplate;
+
+// Global arrays to store data. With --shared they point into the shared
+// store instead, and the counts are the slots this counter has indexed.
+Trip ownTrips[MAX_TRIPS];
+Ticket ownTickets[MAX_TICKETS];
+TripTemplate ownTemplates[MAX_TEMPLATES];
+Trip *trips = ownTrips;
+Ticket *tickets = ownTickets;
+TripTemplate *templates = ownTemplates;
 int tripCount = 0;
 int ticketCount = 0;
+int templateCount = 0;
+
+// Lookup indexes (rebuilt after loading, maintained on every change)
+int tripHashHead[TRIP_HASH_SIZE];
+int tripHashNext[MAX_TRIPS];
+int ticketHashHead[TICKET_HASH_SIZE];
+int ticketHashNext[MAX_TICKETS];
+int tripFirstTicket[MAX_TRIPS]; // Active tickets of each trip, in sale order
+int tripLastTicket[MAX_TRIPS];
+int ticketNextInTrip[MAX_TICKETS];
+unsigned long long segmentSeats[MAX_TRIPS][MAX_STOPS - 1]; // Per segment, bit (seat - 1) is set when sold
+int idNumberHashHead[PASSENGER_HASH_SIZE]; // Active tickets by passenger ID number
+int idNumberHashNext[MAX_TICKETS];
+int phoneHashHead[PASSENGER_HASH_SIZE]; // Active tickets by passenger phone
+int phoneHashNext[MAX_TICKETS];
+int lastTicketID = 0;
+int tripJournalCount = 0; // Updates in trips.journal since trips.txt was written
+
+// One field of a record line (not NUL terminated)
+typedef struct {
+    const char *start;
+    int length;
+} Field;
+
+// Seat hold structure (kept in memory while a customer pays)
+typedef struct {
+    int holdID;
+    int tripIndex;
+    int seatNumber;
+    time_t expiresAt;
+    int isActive;
+    int wheelLevel; // Timer wheel slot holding this hold
+    int wheelSlot;
+    int next;
+    int prev;
+} SeatHold;
+
+// Holds and their hierarchical timer wheel
+SeatHold holds[MAX_HOLDS];
+int holdCount = 0;
+int freeHold = -1; // Recycled hold slots
+int lastHoldID = 0;
+int timerWheel[WHEEL_LEVELS][WHEEL_SLOTS]; // Head of each slot's hold list
+time_t wheelTime = 0; // Last second the wheel has processed
+unsigned long long heldMap[MAX_TRIPS]; // Bit (seat - 1) is set while the seat is held
+
+// Waitlist entry; passenger details are packed into one allocation
+// as "fullName\0idNumber\0phoneNumber\0email\0"
+typedef struct {
+    int tripID;
+    int fromStop;
+    int toStop;
+    char *details;
+    int next; // Next entry in the trip's queue (or free list)
+} WaitlistEntry;
+
+// Waitlist record as stored in waitlist.txt
+typedef struct {
+    int tripID;
+    int fromStop;
+    int toStop;
+    Passenger passenger;
+} WaitlistRecord;
+
+// Per-trip FIFO waitlists
+WaitlistEntry waitlist[MAX_WAITLIST];
+int waitlistCount = 0;
+int freeWaitlist = -1; // Recycled entries
+int waitlistHead[MAX_TRIPS];
+int waitlistTail[MAX_TRIPS];
+int waitlistLength[MAX_TRIPS];
+
+// Radix trie node; the edge label is a slice of the trie's label pool
+typedef struct {
+    int labelStart;
+    int labelLength;
+    int firstChild;
+    int nextSibling;
+    int firstPosting; // Values whose key ends exactly here
+} TrieNode;
+
+// Value stored under a trie key
+typedef struct {
+    int value;
+    int next;
+} TriePosting;
+
+// Compact radix trie over case-folded names
+typedef struct {
+    TrieNode *nodes;
+    int nodeCount;
+    int nodeCapacity;
+    char *labels;
+    int labelSize;
+    int labelCapacity;
+    TriePosting *postings;
+    int postingCount;
+    int postingCapacity;
+    int freePosting;
+} NameTrie;
+
+// Position reached by a prefix walk, so longer prefixes can continue from it
+typedef struct {
+    int node; // -1 once the prefix has no matches
+    int matched; // Bytes of the node's label already matched
+    char prefix[MAX_FOLDED]; // Folded prefix consumed so far
+} TrieCursor;
+
+// Name search indexes
+NameTrie passengerTrie; // Passenger names -> active ticket index
+NameTrie driverTrie; // Driver names -> active trip index
+
+// One changed slot in the shared store's change log
+typedef struct {
+    int kind; // CHANGE_TRIP, CHANGE_TICKET or CHANGE_TEMPLATE
+    int index;
+} SharedChange;
+
+// Trip and ticket store mapped by every counter running with --shared.
+// The counters work on these arrays in place, under the lock. Each change
+// bumps the version once per changed slot and logs the slot, so the other
+// counters update their own indexes for just those slots. The data files
+// are written after the lock is released, one counter at a time.
+typedef struct {
+    unsigned int magic;
+    unsigned int storeSize; // sizeof(SharedStore), so an old layout is rebuilt
+    pthread_mutex_t lock; // Process-shared and robust
+    pthread_mutex_t saveLock; // Held while writing the data files or the trip journal
+    unsigned long version; // Changed slots logged so far
+    unsigned long rebuildVersion; // Counters behind this version index everything again
+    unsigned long tripsSavedVersion; // Version trips.txt was last written at
+    unsigned long ticketsSavedVersion;
+    unsigned long templatesSavedVersion;
+    SharedChange changes[SHARED_LOG_SIZE]; // Slot changed at version v is at v % SHARED_LOG_SIZE
+    pid_t counterPid[MAX_COUNTERS]; // 0 if the counter slot is free
+    unsigned long long heldSeats[MAX_COUNTERS][MAX_TRIPS]; // Each counter's heldMap
+    int tripCount;
+    int ticketCount;
+    int tripJournalCount; // Lines in the shared trips.journal
+    int templateCount;
+    Trip trips[MAX_TRIPS];
+    Ticket tickets[MAX_TICKETS];
+    TripTemplate templates[MAX_TEMPLATES];
+} SharedStore;
+
+// Replication state. The primary keeps the last copy it sent and sends
+// records that differ from it; a standby collects a batch in these arrays
+// and applies it once complete.
+int replicaRole = REPLICA_NONE;
+char replicaPath[sizeof(((struct sockaddr_un *)0)->sun_path)];
+int replicaListener = -1; // Primary: socket the standby connects to
+int replicaSocket = -1; // Connection to the other side
+Trip replicaTrips[MAX_TRIPS];
+Ticket replicaTickets[MAX_TICKETS];
+TripTemplate replicaTemplates[MAX_TEMPLATES];
+int replicaTripCount = 0;
+int replicaTicketCount = 0;
+int replicaTemplateCount = 0;
+int replicaLastTicketID = 0;
+long replicaArchiveSize = 0; // Bytes of archive.dat the standby has (or gets with this batch)
+unsigned char *replicaArchive = NULL; // Standby: the batch's archive bytes, written when it closes
+long replicaArchiveStart = -1; // Their offset in archive.dat, -1 if the batch has none
+int replicaArchiveLength = 0;
+int replicaArchiveCapacity = 0;
+char *replicaInput = NULL; // Standby: received bytes not yet applied
+size_t replicaInputLength = 0;
+size_t replicaInputCapacity = 0;
+
+// Multi-counter state (sharedStore is NULL when running alone)
+SharedStore *sharedStore = NULL;
+unsigned long sharedVersion = 0; // Store version this counter's indexes reflect
+int sharedLocked = 0; // This counter holds the store lock; file writes wait for its release
+int pendingSaves = 0; // SAVE_* files to write once the lock is released
+Trip indexedTrips[MAX_TRIPS]; // Each slot as this counter last indexed it
+Ticket indexedTickets[MAX_TICKETS];
+TripTemplate indexedTemplates[MAX_TEMPLATES];
+int counterSlot = 0;
+char waitlistFile[MAX_STRING] = "waitlist.txt"; // Waitlists stay with their counter
+
+// A trip's time window in a schedule treap, ordered by start time.
+// Node i always belongs to trip i.
+typedef struct {
+    int start; // Minutes since 01/01/1970
+    int end; // Exclusive
+    int maxEnd; // Latest end in this subtree
+    unsigned int priority;
+    int left;
+    int right;
+} IntervalNode;
+
+// Trips of one bus or one driver
+typedef struct {
+    char key[MAX_FOLDED];
+    int root;
+    int tripCount;
+    int next; // Next tree in the hash bucket (or free list)
+} ScheduleTree;
+
+// Interval trees keyed by bus plate or driver name
+typedef struct {
+    IntervalNode nodes[MAX_TRIPS];
+    int treeOf[MAX_TRIPS]; // Tree holding each trip (-1 if not scheduled)
+    ScheduleTree trees[MAX_TRIPS];
+    int treeCount;
+    int freeTree;
+    int hashHead[SCHEDULE_HASH_SIZE];
+} ScheduleIndex;
+
+// Bus and driver schedules of the active trips
+ScheduleIndex busSchedule;
+ScheduleIndex driverSchedule;
+
+// One active trip as an edge of the time-expanded route graph
+typedef struct {
+    int departure; // Minutes since 1970, as in the schedules
+    int arrival;
+    int fromCity;
+    int toCity;
+    int tripIndex; // -1 for a recurring trip's instance not made yet
+    int tripID;
+} Connection;
+
+// Cities by folded name, and the active trips sorted by departure.
+// Sold out trips stay in the graph and are skipped while searching;
+// recurring trips' instances are added only for the search at hand.
+char cityNames[MAX_CITIES][MAX_FOLDED];
+int cityHashHead[CITY_HASH_SIZE];
+int cityHashNext[MAX_CITIES];
+int cityCount = 0;
+Connection connections[MAX_TRIPS + MAX_TEMPLATES * JOURNEY_DAYS];
+int connectionCount = 0;
+
+// Header of one archive block. It is followed by the IDs of the block's
+// trips and the compressed "T|trip" and "K|ticket" lines.
+typedef struct {
+    unsigned int magic;
+    int tripCount;
+    int ticketCount;
+    int rawSize;
+    int compressedSize;
+    int lastTicketID; // Highest ticket ID issued when the block was written
+} ArchiveBlockHeader;
+
+// Block holding an archived trip
+typedef struct {
+    int tripID;
+    long offset;
+    int next; // Older entry in the same hash bucket, -1 at the end
+} ArchiveEntry;
+
+// Block index of the archive, read from the block headers and hashed by
+// trip ID (newest entry first in each bucket)
+ArchiveEntry *archiveIndex = NULL;
+int archiveHashHead[ARCHIVE_HASH_SIZE];
+int archiveIndexCount = 0;
+int archiveIndexCapacity = 0;
+long archiveIndexedSize = 0; // Archive bytes covered by the index
+int archivedLastTicketID = 0; // New ticket IDs start above this
+
+// A valid ticket of the trip being boarded, kept sorted by ticket ID
+typedef struct {
+    int ticketID;
+    int ticketIndex;
+} BoardingEntry;
+
+// Start of an operation log, followed by a copy of each data file
+typedef struct {
+    unsigned int magic;
+    unsigned int version;
+    long long startTime; // Wall clock time the capture began
+    int fileCount;
+} OperationLogHeader;
+
+// A data file copied into the log, followed by its bytes
+typedef struct {
+    char name[OPLOG_FILE_NAME];
+    long long size;
+} OperationLogFile;
+
+// One captured operation, followed by every input byte it read
+// (its menu choice line included)
+typedef struct {
+    unsigned int delayMicros; // Since the previous operation started
+    unsigned int inputLength;
+    int choice;
+} OperationRecord;
+
+// Capture and replay state (both logs are NULL in a normal run)
+FILE *captureLog = NULL;
+FILE *replayLog = NULL;
+int replayFast = 0; // Replay at maximum speed instead of the recorded pace
+char *operationInput = NULL; // Input bytes of the current operation
+unsigned int operationInputLength = 0;
+unsigned int operationInputCapacity = 0;
+unsigned int operationInputPos = 0; // Bytes already served during replay
+OperationRecord currentOperation;
+int operationPending = 0;
+struct timespec operationStarted; // When the current operation was dispatched
+struct timespec replayStarted;
+double replayDue = 0; // Seconds after replayStarted the next operation is due
+long long replayStartTime = 0; // The captured session's wall clock...
+double replayClock = 0; // ...and seconds into it at the current operation
+char replayDirectory[MAX_STRING]; // Scratch copy of the data the replay runs on
+double *replayLatencies = NULL;
+int replayCount = 0;
+int replayCapacity = 0;
+int replayKindCount[OPERATION_KINDS];
+double replayKindSeconds[OPERATION_KINDS];
+
+// Columnar copy of the active trips and tickets used for reports
+typedef struct {
+    int tripCount;
+    int *tripSource; // Index into trips[] for each row
+    int *tripSeats;
+    int *tripSeatSegments; // Seats times route segments, the load factor base
+    int *tripGroup; // Group of each trip for the current report
+    int ticketCount;
+    int *ticketTrip; // Trip row of each ticket
+    int *ticketSegments; // Route segments the ticket covers
+    long long *ticketKurus; // Price in kuruş, so sums are exact
+} AnalyticsView;
+
+// A slice of a data file handled by one loader thread
+typedef struct {
+    char *begin;
+    char *end;
+    int firstRecord; // Index of the first record in this slice
+    int recordCount;
+    int maxRecords;
+    char *records;
+    size_t recordSize;
+    signed char *status; // RECORD_* result for each line
+    int (*parseRecord)(const Field *fields, int fieldCount, void *record);
+} LoadChunk;
 
 // Function prototypes
 void displayMenu();
@@ -61,30 +567,296 @@ void inquireTrip();
 void listAllTrips();
 void sellTicket();
 void cancelTicket();
+void sellGroupTickets();
+void readPassengerInfo(Passenger *passenger);
+int issueTicket(int tripIndex, int seatNumber, int fromStop, int toStop, const Passenger *passenger);
+int findAdjacentSeats(int tripIndex, int count, int fromStop, int toStop);
+void holdSeat();
+void initHoldTimers();
+void advanceHoldTimers();
+void scheduleHold(int holdIndex);
+void releaseHold(int holdIndex);
+int findHoldForSeat(int tripIndex, int seatNumber);
+void joinWaitlist(int tripIndex, int fromStop, int toStop);
+int enqueueWaitlist(int tripIndex, int fromStop, int toStop, const Passenger *passenger);
+int dequeueWaitlist(int tripIndex, Passenger *passenger, int *fromStop, int *toStop);
+void clearWaitlist(int tripIndex);
+int promoteFromWaitlist(int tripIndex);
+void saveWaitlistToFile();
+void writeWaitlistFile();
+void loadWaitlistFromFile();
+int parseWaitlistRecord(const Field *fields, int fieldCount, void *record);
 void createReceipt(int ticketID);
 void saveTripsToFile();
+int writeTripsFile(int count);
+FILE *openDataFile(const char *filename, char *tempName, size_t size);
+int closeDataFile(FILE *file, const char *tempName, const char *filename);
 void loadTripsFromFile();
 void saveTicketsToFile();
+int writeTicketsFile(int count);
 void loadTicketsFromFile();
+int loadRecordsFromFile(const char *filename, void *records, size_t recordSize, int maxRecords,
+                        int (*parseRecord)(const Field *fields, int fieldCount, void *record));
+int parseTripRecord(const Field *fields, int fieldCount, void *record);
+int parseTicketRecord(const Field *fields, int fieldCount, void *record);
+void writeTripRecord(FILE *file, const Trip *trip);
+int parseTripChangeRecord(const Field *fields, int fieldCount, void *record);
+void appendTripJournal(const Trip *trip, int mask);
+void replayTripJournal();
+void applyTripChanges(Trip *trip, const Trip *changed, int mask);
+int validateTripChanges(int tripIndex, const Trip *changed, int mask);
+int commitTripChanges(int tripID, const Trip *changed, int mask);
+void writeTicketRecord(FILE *file, const Ticket *ticket);
+int splitFields(const char **p, const char *end, Field *fields);
+const char *findDelimiter(const char *p, const char *end);
+int countNewlines(const char *p, const char *end);
+int parseIntField(const Field *field, int *value);
+int parseLongField(const Field *field, long *value);
+int parsePriceField(const Field *field, float *value);
+int copyTextField(char *dest, const Field *field);
+void rebuildIndexes();
+void indexTrip(int tripIndex);
+void indexTicket(int ticketIndex);
+void unindexTicket(int ticketIndex);
+void linkTicket(int ticketIndex);
+void unlinkTicket(int ticketIndex, const Ticket *ticket);
+int isSeatOccupied(int tripIndex, int seatNumber, int fromStop, int toStop);
+int getStopCount(int tripIndex);
+int getTripStops(int tripIndex, char names[][MAX_STRING]);
+int splitStops(const char *stops, char names[][MAX_STRING], int limit, int *blank);
+int readSegment(int tripIndex, int *fromStop, int *toStop);
+unsigned long long allSeatsMask(int totalSeats);
+unsigned long long occupiedSeats(int tripIndex, int fromStop, int toStop);
+unsigned long long freeSeatMap(int tripIndex, int fromStop, int toStop);
+int availableSeatsFor(int tripIndex, int fromStop, int toStop);
+void refreshAvailableSeats(int tripIndex);
+int validateStops(const char *stops);
+unsigned int hashString(const char *text, unsigned int tableSize);
+void makePhoneKey(const char *phone, char *key);
+int isIdNumber(const char *text);
+void indexPassenger(int ticketIndex);
+void unindexPassenger(int ticketIndex, const Ticket *ticket);
+void findPassengerTickets();
+void foldName(const char *name, char *folded, size_t size);
+void trieReset(NameTrie *trie);
+void trieInsert(NameTrie *trie, const char *key, int keyLength, int value);
+void trieRemove(NameTrie *trie, const char *key, int keyLength, int value);
+void trieInsertName(NameTrie *trie, const char *name, int value);
+void trieRemoveName(NameTrie *trie, const char *name, int value);
+void trieCursorStart(TrieCursor *cursor);
+void trieCursorAdvance(const NameTrie *trie, TrieCursor *cursor, const char *folded);
+int trieCollect(const NameTrie *trie, const TrieCursor *cursor, int *values, int limit);
+void searchByName();
+int parseDate(const char *date, int *days);
+long long priceToKurus(float price);
+void formatKurus(long long kurus, char *buffer, size_t size);
+int buildAnalyticsView(AnalyticsView *view);
+void freeAnalyticsView(AnalyticsView *view);
+int groupAnalyticsView(AnalyticsView *view, int groupBy, char (*names)[GROUP_NAME_LENGTH]);
+void showReports();
+int parseTime(const char *time, int *minutes);
+int getTripWindow(const Trip *trip, int *start, int *end);
+void makeBusKey(const char *plate, char *key, size_t size);
+void scheduleReset(ScheduleIndex *index);
+void scheduleInsert(ScheduleIndex *index, const char *key, int tripIndex, int start, int end);
+void scheduleRemove(ScheduleIndex *index, int tripIndex);
+int scheduleFindTree(const ScheduleIndex *index, const char *key);
+int scheduleFindOverlap(const ScheduleIndex *index, const char *key, int start, int end);
+int scheduleCollect(const ScheduleIndex *index, int root, int from, int *tripIndexes, int count);
+void intervalUpdate(IntervalNode *nodes, int node);
+int intervalMerge(IntervalNode *nodes, int left, int right);
+void intervalSplit(IntervalNode *nodes, int root, int node, int *left, int *right);
+void scheduleTrip(int tripIndex);
+void unscheduleTrip(int tripIndex);
+int checkScheduleConflicts(const Trip *trip, int tripIndex);
+int isScheduleFree(const Trip *trip);
+void showSchedule();
+void resetConnections();
+int findCity(const char *name, int add);
+void addConnection(int tripIndex);
+void insertConnection(const Connection *connection);
+void addInstanceConnections(int startDay);
+void removeInstanceConnections();
+void showJourneys(int fromCity, int toCity, int start, int transferMinutes);
+void removeConnection(int tripIndex);
+void scanConnections(int fromCity, int toCity, int start, int transferMinutes,
+                     int arrival[][MAX_CITIES], int via[][MAX_CITIES]);
+int collectJourney(int round, int fromCity, int toCity, int via[][MAX_CITIES], int *legs);
+void printJourney(const int *legs, int legCount);
+void formatMinutes(int minutes, char *buffer, size_t size);
+void planJourney();
+int getCurrentDay();
+void formatDay(int day, char *buffer, size_t size);
+void saveTemplatesToFile();
+int writeTemplatesFile(int count);
+void loadTemplatesFromFile();
+void writeTemplateRecord(FILE *file, const TripTemplate *tripTemplate);
+int parseTemplateRecord(const Field *fields, int fieldCount, void *record);
+int findTemplateByID(int templateID);
+int getInstanceDay(const TripTemplate *tripTemplate, int dayOffset, int *day);
+int materializeInstance(int tripID);
+int makeInstanceTrip(int tripID, Trip *trip);
+int findTripRecord(int tripID);
+int findTripOrInstance(int tripID);
+void manageTemplates();
+int makeReplicaAddress(const char *path, struct sockaddr_un *address);
+int startPrimary(const char *path);
+int startStandby(const char *path);
+int isSameUserPeer(int fd);
+int connectToPrimary();
+void closeReplication();
+int sendAll(int fd, const char *data, size_t size);
+long writeArchiveLines(FILE *out, long from, long to);
+void shipChanges(int snapshot);
+int receiveChanges();
+void applyReceivedChanges();
+ssize_t keyboardRead(void *cookie, char *buffer, size_t size);
+int hexDigitValue(char c);
+void applyReplicaLine(const char *line, const char *end);
+void waitForInput();
+int isStandbyChoice(int choice);
+void promoteStandby();
+void createTemplate();
+void listTemplates();
+void stopTemplate();
+int lzCompress(const unsigned char *in, int size, unsigned char *out);
+int lzDecompress(const unsigned char *in, int size, unsigned char *out, int capacity);
+int lzWriteLiterals(const unsigned char *literals, int count, unsigned char *out);
+unsigned int lzHash(const unsigned char *p);
+void clearArchiveIndex();
+void refreshArchiveIndex();
+char *readArchiveBlock(long offset, ArchiveBlockHeader *header);
+int appendArchiveBlock(FILE *file, const char *raw, int rawSize, const int *tripIDs, int tripCount,
+                       int ticketCount, long *compressedTotal);
+void archiveDepartedTrips();
+void boardTrip();
+int compareBoardingEntries(const void *a, const void *b);
+int findBoardingEntry(const BoardingEntry *entries, int count, int ticketID);
+int showArchivedTrip(int tripID);
+int isArchivedTrip(int tripID);
+int startCapture(const char *filename);
+int snapshotDataFiles(FILE *log);
+int restoreDataFiles(FILE *log, int fileCount);
+time_t currentTime();
+int startReplay(const char *filename);
+ssize_t captureRead(void *cookie, char *buffer, size_t size);
+ssize_t replayRead(void *cookie, char *buffer, size_t size);
+int reserveOperationInput(size_t length);
+int appendOperationInput(const char *data, size_t length);
+void beginOperation(int choice);
+void endOperation();
+void writeCapturedOperation();
+int nextReplayOperation();
+void finishCapture();
+void reportReplay();
+int compareLatencies(const void *a, const void *b);
+double secondsBetween(const struct timespec *from, const struct timespec *to);
+int openSharedStore();
+void closeSharedStore();
+void lockSharedStore();
+void unlockSharedStore();
+void lockSavedFiles();
+void unlockSavedFiles();
+void requestSave(int files);
+void flushSaves();
+void reindexSharedStore();
+void pullSharedStore();
+int isTicketMoved(const Ticket *old, const Ticket *ticket);
+int forgetDeletedTrip(int tripIndex);
+void logSharedChanges();
+void beginSharedUpdate();
+void endSharedUpdate(int changed);
+void syncSharedStore();
+int isCounterAlive(pid_t pid);
+void publishHeldSeats(int tripIndex);
+unsigned long long heldSeatMap(int tripIndex);
 int findTripByID(int tripID);
 int findTicketByID(int ticketID);
 void clearInputBuffer();
 void getCurrentDateTime(char *buffer, size_t);
 
-int main() {
+int main(int argc, char *argv[]) {
     int choice;
     
-    // Load existing data from files
-    loadTripsFromFile();
-    loadTicketsFromFile();
+    int shared = 0;
+    const char *captureFile = NULL;
+    const char *replayFile = NULL;
+    const char *primaryPath = NULL;
+    const char *standbyPath = NULL;
+    int usage = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--shared") == 0) {
+            shared = 1;
+        } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            captureFile = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayFile = argv[++i];
+        } else if (strcmp(argv[i], "--fast") == 0) {
+            replayFast = 1;
+        } else if (strcmp(argv[i], "--primary") == 0 && i + 1 < argc) {
+            primaryPath = argv[++i];
+        } else if (strcmp(argv[i], "--standby") == 0 && i + 1 < argc) {
+            standbyPath = argv[++i];
+        } else {
+            usage = 1;
+        }
+    }
+    // A standby has its own store, and replication waits on the keyboard itself
+    if (usage || (captureFile != NULL && replayFile != NULL) || (replayFast && replayFile == NULL) ||
+        (primaryPath != NULL && standbyPath != NULL) || (standbyPath != NULL && shared) ||
+        ((primaryPath != NULL || standbyPath != NULL) && replayFile != NULL)) {
+        printf("Usage: %s [--shared] [--capture FILE | --replay FILE [--fast]]\n", argv[0]);
+        printf("       %s [--shared] --primary SOCKET\n", argv[0]);
+        printf("       %s --standby SOCKET\n", argv[0]);
+        return 1;
+    }
+    
+    // A replay runs on the data captured with its log, in a scratch directory
+    if (replayFile != NULL && !startReplay(replayFile)) {
+        return 1;
+    }
+    
+    // Load existing data from files, or join the counters already running
+    clearArchiveIndex();
+    if (shared) {
+        if (!openSharedStore()) {
+            return 1;
+        }
+    } else {
+        loadTripsFromFile();
+        loadTicketsFromFile();
+        loadTemplatesFromFile();
+        refreshArchiveIndex();
+        rebuildIndexes();
+    }
+    loadWaitlistFromFile();
+    initHoldTimers();
+    
+    // From here on operation input goes through the capture or replay stream
+    if ((captureFile != NULL && !startCapture(captureFile)) ||
+        (primaryPath != NULL && !startPrimary(primaryPath)) ||
+        (standbyPath != NULL && !startStandby(standbyPath))) {
+        closeSharedStore();
+        return 1;
+    }
     
     printf("========================================\n");
     printf("   BUS TICKETING SYSTEM\n");
     printf("========================================\n\n");
     
     while (1) {
+        // Log the operation just finished, or queue the next logged one
+        writeCapturedOperation();
+        if (replayLog != NULL && !nextReplayOperation()) {
+            break;
+        }
+        
+        // Send what the last operation changed to the standby
+        shipChanges(0);
+        
         displayMenu();
         printf("Enter your choice: ");
+        waitForInput();
         char buf[16];
 
         if (!fgets(buf, sizeof(buf), stdin)) {
@@ -93,27 +865,62 @@ int main() {
         }
 
         choice = atoi(buf);
+        beginOperation(choice);
 
+        // Release seat holds that ran out while waiting for input
+        advanceHoldTimers();
         
-        switch(choice) {
-            case 1: createTrip(); break;
-            case 2: updateTrip(); break;
-            case 3: deleteTrip(); break;
-            case 4: inquireTrip(); break;
-            case 5: listAllTrips(); break;
-            case 6: sellTicket(); break;
-            case 7: cancelTicket(); break;
-            case 0:
-                printf("\nSaving data and exiting...\n");
-                saveTripsToFile();
-                saveTicketsToFile();
-                printf("Thank you for using Bus Ticketing System!\n");
-                return 0;
-            default:
-                printf("\nInvalid choice! Please try again.\n");
+        // Pick up sales made at other counters
+        syncSharedStore();
+        
+        // A standby only answers inquiries until it is promoted
+        if (replicaRole == REPLICA_STANDBY && !isStandbyChoice(choice)) {
+            printf("\nThis counter is a standby and only answers inquiries.\n");
+            printf("Choose %d to promote it if the primary has stopped.\n", PROMOTE_CHOICE);
+        } else {
+            switch(choice) {
+                case 1: createTrip(); break;
+                case 2: updateTrip(); break;
+                case 3: deleteTrip(); break;
+                case 4: inquireTrip(); break;
+                case 5: listAllTrips(); break;
+                case 6: sellTicket(); break;
+                case 7: cancelTicket(); break;
+                case 8: sellGroupTickets(); break;
+                case 9: holdSeat(); break;
+                case 10: findPassengerTickets(); break;
+                case 11: searchByName(); break;
+                case 12: showReports(); break;
+                case 13: showSchedule(); break;
+                case 14: archiveDepartedTrips(); break;
+                case 15: boardTrip(); break;
+                case 16: planJourney(); break;
+                case 17: manageTemplates(); break;
+                case 0:
+                    printf("\nSaving data and exiting...\n");
+                    beginSharedUpdate();
+                    saveTripsToFile();
+                    saveTicketsToFile();
+                    endSharedUpdate(0);
+                    closeSharedStore();
+                    endOperation();
+                    printf("Thank you for using Bus Ticketing System!\n");
+                    return 0;
+                case PROMOTE_CHOICE:
+                    if (replicaRole == REPLICA_STANDBY) {
+                        promoteStandby();
+                        break;
+                    }
+                    // Fall through
+                default:
+                    printf("\nInvalid choice! Please try again.\n");
+            }
         }
+        endOperation();
         
+        shipChanges(0);
         printf("\nPress Enter to continue...");
+        waitForInput();
         getchar();
     }
     
@@ -132,6 +939,19 @@ void displayMenu() {
     printf("5. List All Trips\n");
     printf("6. Sell Ticket\n");
     printf("7. Cancel Ticket\n");
+    printf("8. Sell Group Tickets\n");
+    printf("9. Hold Seat\n");
+    printf("10. Find My Tickets\n");
+    printf("11. Search by Name\n");
+    printf("12. Reports\n");
+    printf("13. Bus/Driver Schedule\n");
+    printf("14. Archive Departed Trips\n");
+    printf("15. Boarding Mode\n");
+    printf("16. Plan Journey\n");
+    printf("17. Recurring Trips\n");
+    if (replicaRole == REPLICA_STANDBY) {
+        printf("%d. Promote to Primary (standby: read-only until then)\n", PROMOTE_CHOICE);
+    }
     printf("0. Exit\n");
     printf("========================================\n");
 }
@@ -142,9 +962,18 @@ void clearInputBuffer() {
     while ((c = getchar()) != '\n' && c != EOF);
 }
 
+// Wall clock time. A replay runs on the captured session's clock, so hold
+// expiry, archiving and receipts see the times of the original run.
+time_t currentTime() {
+    if (replayLog != NULL) {
+        return (time_t)(replayStartTime + (long long)replayClock);
+    }
+    return time(NULL);
+}
+
 // Get current date and time
 void getCurrentDateTime(char *buffer, size_t size) {
-    time_t now = time(NULL);
+    time_t now = currentTime();
     struct tm t;
 
     if (localtime_r(&now, &t) == NULL) {
@@ -159,627 +988,6127 @@ void getCurrentDateTime(char *buffer, size_t size) {
              t.tm_hour, t.tm_min, t.tm_sec);
 }
 
+// Get today's local date as days since 1970, like parseDate
+int getCurrentDay() {
+    time_t now = currentTime();
+    struct tm t;
+    localtime_r(&now, &t);
+    char today[MAX_STRING];
+    int day;
+    snprintf(today, sizeof(today), "%02d/%02d/%04d", t.tm_mday, t.tm_mon + 1, t.tm_year + 1900);
+    return parseDate(today, &day) ? day : 0;
+}
+
+// Open a data file for rewriting. It is written under a temporary name and
+// renamed over the old file by closeDataFile, so a counter stopped in the
+// middle of a save never leaves a truncated file behind.
+FILE *openDataFile(const char *filename, char *tempName, size_t size) {
+    snprintf(tempName, size, "%s.tmp", filename);
+    return fopen(tempName, "w");
+}
+
+// Finish a file opened with openDataFile (returns 0 if it was not written)
+int closeDataFile(FILE *file, const char *tempName, const char *filename) {
+    int failed = ferror(file);
+    if (fclose(file) != 0 || failed || rename(tempName, filename) != 0) {
+        remove(tempName);
+        return 0;
+    }
+    return 1;
+}
+
 // Save all trips to file
 void saveTripsToFile() {
-    FILE *file = fopen("trips.txt", "w");
+    requestSave(SAVE_TRIPS);
+}
+
+// Write the first count trips to trips.txt (returns 0 if it was not written)
+int writeTripsFile(int count) {
+    char tempName[MAX_STRING];
+    FILE *file = openDataFile("trips.txt", tempName, sizeof(tempName));
     if (file == NULL) {
         printf("Error: Could not open trips file for writing!\n");
-        return;
+        return 0;
     }
     
     // Write trip count
-    fprintf(file, "%d\n", tripCount);
+    fprintf(file, "%d\n", count);
     
     // Write all trips
-    for (int i = 0; i < tripCount; i++) {
-        fprintf(file, "%d|%s|%s|%s|%s|%s|%s|%d|%d|%.2f|%d\n",
-                trips[i].tripID,
-                trips[i].departurePoint,
-                trips[i].arrivalPoint,
-                trips[i].tripDate,
-                trips[i].departureTime,
-                trips[i].busLicensePlate,
-                trips[i].driverName,
-                trips[i].totalSeats,
-                trips[i].availableSeats,
-                trips[i].ticketPrice,
-                trips[i].isActive);
+    for (int i = 0; i < count; i++) {
+        writeTripRecord(file, &trips[i]);
     }
     
-    fclose(file);
+    // Journaled updates are part of the new file now
+    if (!closeDataFile(file, tempName, "trips.txt")) {
+        return 0;
+    }
+    remove(TRIP_JOURNAL_FILE);
+    tripJournalCount = 0;
+    return 1;
+}
+
+// Write one trip line
+void writeTripRecord(FILE *file, const Trip *trip) {
+    fprintf(file, "%d|%s|%s|%s|%s|%s|%s|%d|%d|%.2f|%d|%s|%s\n",
+            trip->tripID,
+            trip->departurePoint,
+            trip->arrivalPoint,
+            trip->tripDate,
+            trip->departureTime,
+            trip->busLicensePlate,
+            trip->driverName,
+            trip->totalSeats,
+            trip->availableSeats,
+            trip->ticketPrice,
+            trip->isActive,
+            trip->stops,
+            trip->arrivalTime);
+}
+
+// Parse one trip line (returns a RECORD_* result)
+int parseTripRecord(const Field *fields, int fieldCount, void *record) {
+    Trip *trip = (Trip *)record;
+    if (fieldCount < 11 || fieldCount > 13) { // Older files lack stops and arrival time
+        return RECORD_BAD_FIELD_COUNT;
+    }
+    
+    if (!parseIntField(&fields[0], &trip->tripID) ||
+        !parseIntField(&fields[7], &trip->totalSeats) ||
+        !parseIntField(&fields[8], &trip->availableSeats) ||
+        !parsePriceField(&fields[9], &trip->ticketPrice) ||
+        !parseIntField(&fields[10], &trip->isActive)) {
+        return RECORD_BAD_NUMBER;
+    }
+    
+    int truncated = 0;
+    truncated |= copyTextField(trip->departurePoint, &fields[1]);
+    truncated |= copyTextField(trip->arrivalPoint, &fields[2]);
+    truncated |= copyTextField(trip->tripDate, &fields[3]);
+    truncated |= copyTextField(trip->departureTime, &fields[4]);
+    truncated |= copyTextField(trip->busLicensePlate, &fields[5]);
+    truncated |= copyTextField(trip->driverName, &fields[6]);
+    trip->stops[0] = '\0';
+    trip->arrivalTime[0] = '\0';
+    if (fieldCount >= 12) {
+        truncated |= copyTextField(trip->stops, &fields[11]);
+    }
+    if (fieldCount == 13) {
+        truncated |= copyTextField(trip->arrivalTime, &fields[12]);
+    }
+    return truncated ? RECORD_TRUNCATED : RECORD_OK;
+}
+
+// Parse one journal line: the FIELD_* mask followed by a trip line
+int parseTripChangeRecord(const Field *fields, int fieldCount, void *record) {
+    TripChange *change = (TripChange *)record;
+    if (fieldCount != 14) {
+        return RECORD_BAD_FIELD_COUNT;
+    }
+    if (!parseIntField(&fields[0], &change->mask)) {
+        return RECORD_BAD_NUMBER;
+    }
+    return parseTripRecord(fields + 1, fieldCount - 1, &change->trip);
+}
+
+// Record one committed trip update, or rewrite trips.txt once the journal is full
+void appendTripJournal(const Trip *trip, int mask) {
+    int written = 0;
+    lockSavedFiles();
+    if (tripJournalCount < MAX_JOURNAL_RECORDS) {
+        FILE *file = fopen(TRIP_JOURNAL_FILE, "a");
+        if (file == NULL) {
+            printf("Error: Could not open trip journal for writing!\n");
+        } else {
+            // The loader skips the first line like the count header of the other files
+            if (ftell(file) == 0) {
+                fprintf(file, "mask|trip\n");
+            }
+            fprintf(file, "%d|", mask);
+            writeTripRecord(file, trip);
+            
+            if (fclose(file) != 0) {
+                printf("Error: Could not write trip journal!\n");
+            } else {
+                tripJournalCount++;
+                written = 1;
+            }
+        }
+    }
+    unlockSavedFiles();
+    
+    if (!written) {
+        saveTripsToFile();
+    }
+}
+
+// Apply the updates journaled since trips.txt was last written
+void replayTripJournal() {
+    TripChange *changes = malloc(sizeof(TripChange) * MAX_JOURNAL_RECORDS);
+    if (changes == NULL) {
+        printf("Error: Not enough memory to load the trip journal!\n");
+        return;
+    }
+    
+    int loaded = loadRecordsFromFile(TRIP_JOURNAL_FILE, changes, sizeof(TripChange), MAX_JOURNAL_RECORDS,
+                                     parseTripChangeRecord);
+    int replayed = 0;
+    for (int i = 0; i < loaded; i++) {
+        // The indexes are built after loading, so look the trip up directly
+        for (int t = 0; t < tripCount; t++) {
+            if (trips[t].tripID == changes[i].trip.tripID) {
+                applyTripChanges(&trips[t], &changes[i].trip, changes[i].mask);
+                replayed++;
+                break;
+            }
+        }
+    }
+    
+    free(changes);
+    tripJournalCount = loaded > 0 ? loaded : 0;
+    if (replayed > 0) {
+        printf("Replayed %d trip updates from the journal.\n", replayed);
+    }
 }
 
 // Load all trips from file
 void loadTripsFromFile() {
-    FILE *file = fopen("trips.txt", "r");
-    if (file == NULL) {
+    int loaded = loadRecordsFromFile("trips.txt", trips, sizeof(Trip), MAX_TRIPS, parseTripRecord);
+    if (loaded < 0) {
         // File doesn't exist yet, this is normal on first run
         tripCount = 0;
         return;
     }
     
-    // Read trip count
-    fscanf(file, "%d\n", &tripCount);
-    
-    // Read all trips
-    for (int i = 0; i < tripCount; i++) {
-        fscanf(file, "%d|%99[^|]|%99[^|]|%99[^|]|%99[^|]|%99[^|]|%99[^|]|%d|%d|%f|%d\n",
-               &trips[i].tripID,
-               trips[i].departurePoint,
-               trips[i].arrivalPoint,
-               trips[i].tripDate,
-               trips[i].departureTime,
-               trips[i].busLicensePlate,
-               trips[i].driverName,
-               &trips[i].totalSeats,
-               &trips[i].availableSeats,
-               &trips[i].ticketPrice,
-               &trips[i].isActive);
-    }
-    
-    fclose(file);
+    tripCount = loaded;
     printf("Loaded %d trips from file.\n", tripCount);
+    replayTripJournal();
 }
 
 // Save all tickets to file
 void saveTicketsToFile() {
-    FILE *file = fopen("tickets.txt", "w");
+    requestSave(SAVE_TICKETS);
+}
+
+// Write the first count tickets to tickets.txt (returns 0 if it was not written)
+int writeTicketsFile(int count) {
+    char tempName[MAX_STRING];
+    FILE *file = openDataFile("tickets.txt", tempName, sizeof(tempName));
     if (file == NULL) {
         printf("Error: Could not open tickets file for writing!\n");
-        return;
+        return 0;
     }
     
     // Write ticket count
-    fprintf(file, "%d\n", ticketCount);
+    fprintf(file, "%d\n", count);
     
     // Write all tickets
-    for (int i = 0; i < ticketCount; i++) {
-        fprintf(file, "%d|%d|%d|%s|%s|%s|%s|%.2f|%s|%d\n",
-                tickets[i].ticketID,
-                tickets[i].tripID,
-                tickets[i].seatNumber,
-                tickets[i].passenger.fullName,
-                tickets[i].passenger.idNumber,
-                tickets[i].passenger.phoneNumber,
-                tickets[i].passenger.email,
-                tickets[i].price,
-                tickets[i].purchaseDate,
-                tickets[i].isActive);
+    for (int i = 0; i < count; i++) {
+        writeTicketRecord(file, &tickets[i]);
     }
     
-    fclose(file);
+    return closeDataFile(file, tempName, "tickets.txt");
+}
+
+// Write one ticket line
+void writeTicketRecord(FILE *file, const Ticket *ticket) {
+    fprintf(file, "%d|%d|%d|%s|%s|%s|%s|%.2f|%s|%d|%d|%d|%d\n",
+            ticket->ticketID,
+            ticket->tripID,
+            ticket->seatNumber,
+            ticket->passenger.fullName,
+            ticket->passenger.idNumber,
+            ticket->passenger.phoneNumber,
+            ticket->passenger.email,
+            ticket->price,
+            ticket->purchaseDate,
+            ticket->isActive,
+            ticket->fromStop,
+            ticket->toStop,
+            ticket->boarded);
+}
+
+// Parse one ticket line (returns a RECORD_* result)
+int parseTicketRecord(const Field *fields, int fieldCount, void *record) {
+    Ticket *ticket = (Ticket *)record;
+    if (fieldCount != 10 && fieldCount != 12 && fieldCount != 13) { // Older files lack segments and boarding
+        return RECORD_BAD_FIELD_COUNT;
+    }
+    
+    // Full route unless the file says otherwise (resolved when indexing)
+    ticket->fromStop = 0;
+    ticket->toStop = -1;
+    ticket->boarded = 0;
+    if (fieldCount >= 12 &&
+        (!parseIntField(&fields[10], &ticket->fromStop) || !parseIntField(&fields[11], &ticket->toStop))) {
+        return RECORD_BAD_NUMBER;
+    }
+    if (fieldCount == 13 && !parseIntField(&fields[12], &ticket->boarded)) {
+        return RECORD_BAD_NUMBER;
+    }
+    
+    if (!parseIntField(&fields[0], &ticket->ticketID) ||
+        !parseIntField(&fields[1], &ticket->tripID) ||
+        !parseIntField(&fields[2], &ticket->seatNumber) ||
+        !parsePriceField(&fields[7], &ticket->price) ||
+        !parseIntField(&fields[9], &ticket->isActive)) {
+        return RECORD_BAD_NUMBER;
+    }
+    
+    int truncated = 0;
+    truncated |= copyTextField(ticket->passenger.fullName, &fields[3]);
+    truncated |= copyTextField(ticket->passenger.idNumber, &fields[4]);
+    truncated |= copyTextField(ticket->passenger.phoneNumber, &fields[5]);
+    truncated |= copyTextField(ticket->passenger.email, &fields[6]);
+    truncated |= copyTextField(ticket->purchaseDate, &fields[8]);
+    return truncated ? RECORD_TRUNCATED : RECORD_OK;
 }
 
 // Load all tickets from file
 void loadTicketsFromFile() {
-    FILE *file = fopen("tickets.txt", "r");
-    if (file == NULL) {
+    int loaded = loadRecordsFromFile("tickets.txt", tickets, sizeof(Ticket), MAX_TICKETS, parseTicketRecord);
+    if (loaded < 0) {
         // File doesn't exist yet, this is normal on first run
         ticketCount = 0;
         return;
     }
     
-    // Read ticket count
-    fscanf(file, "%d\n", &ticketCount);
-    
-    // Read all tickets
-    for (int i = 0; i < ticketCount; i++) {
-        fscanf(file, "%d|%d|%d|%99[^|]|%99[^|]|%99[^|]|%99[^|]|%f|%99[^|]|%d\n",
-               &tickets[i].ticketID,
-               &tickets[i].tripID,
-               &tickets[i].seatNumber,
-               tickets[i].passenger.fullName,
-               tickets[i].passenger.idNumber,
-               tickets[i].passenger.phoneNumber,
-               tickets[i].passenger.email,
-               &tickets[i].price,
-               tickets[i].purchaseDate,
-               &tickets[i].isActive);
-    }
-    
-    fclose(file);
+    ticketCount = loaded;
     printf("Loaded %d tickets from file.\n", ticketCount);
 }
 
-// Find trip by ID (returns index, -1 if not found)
-int findTripByID(int tripID) {
-    for (int i = 0; i < tripCount; i++) {
-        if (trips[i].tripID == tripID && trips[i].isActive == 1) {
-            return i;
+// Find the next '|' or '\n' (returns end if there is none)
+const char *findDelimiter(const char *p, const char *end) {
+#if defined(__AVX2__)
+    const __m256i pipes32 = _mm256_set1_epi8('|');
+    const __m256i newlines32 = _mm256_set1_epi8('\n');
+    while (end - p >= 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)p);
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, pipes32), _mm256_cmpeq_epi8(block, newlines32)));
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
         }
+        p += 32;
     }
-    return -1;
+#endif
+#if defined(__SSE2__)
+    const __m128i pipes16 = _mm_set1_epi8('|');
+    const __m128i newlines16 = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)p);
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(block, pipes16), _mm_cmpeq_epi8(block, newlines16)));
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+    // Scalar tail (and fallback for other targets)
+    while (p < end && *p != '|' && *p != '\n') {
+        p++;
+    }
+    return p;
 }
 
-// Find ticket by ID (returns index, -1 if not found)
-int findTicketByID(int ticketID) {
-    for (int i = 0; i < ticketCount; i++) {
-        if (tickets[i].ticketID == ticketID && tickets[i].isActive == 1) {
-            return i;
-        }
+// Count '\n' bytes in a range
+int countNewlines(const char *p, const char *end) {
+    int count = 0;
+#if defined(__AVX2__)
+    const __m256i newlines32 = _mm256_set1_epi8('\n');
+    while (end - p >= 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)p);
+        count += __builtin_popcount((unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newlines32)));
+        p += 32;
     }
-    return -1;
+#endif
+#if defined(__SSE2__)
+    const __m128i newlines16 = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)p);
+        count += __builtin_popcount((unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(block, newlines16)));
+        p += 16;
+    }
+#endif
+    while (p < end) {
+        count += *p++ == '\n';
+    }
+    return count;
 }
 
-// Create a new trip
-void createTrip() {
-    printf("\n========================================\n");
-    printf("         CREATE NEW TRIP\n");
-    printf("========================================\n");
+// Parse a decimal integer field (returns 0 if malformed)
+int parseIntField(const Field *field, int *value) {
+    const char *p = field->start;
+    const char *end = p + field->length;
+    int negative = 0;
+    long long result = 0;
     
-    // Check if we have space for more trips
-    if (tripCount >= MAX_TRIPS) {
-        printf("Error: Maximum trip limit reached!\n");
-        return;
+    if (p < end && *p == '-') {
+        negative = 1;
+        p++;
+    }
+    if (p == end) {
+        return 0;
     }
     
-    Trip newTrip;
+    for (; p < end; p++) {
+        if (*p < '0' || *p > '9') {
+            return 0;
+        }
+        result = result * 10 + (*p - '0');
+        if (result > 2147483647LL) {
+            return 0;
+        }
+    }
     
-    // Get Trip ID
-    printf("Enter Trip ID: ");
-    scanf("%d", &newTrip.tripID);
-    clearInputBuffer();
+    *value = negative ? (int)-result : (int)result;
+    return 1;
+}
+
+// Parse a non-negative long field (returns 0 if invalid)
+int parseLongField(const Field *field, long *value) {
+    const char *p = field->start;
+    const char *end = p + field->length;
+    long result = 0;
+    if (p == end) {
+        return 0;
+    }
     
-    // Check if Trip ID already exists
-    if (findTripByID(newTrip.tripID) != -1) {
-        printf("Error: A trip with ID %d already exists!\n", newTrip.tripID);
-        return;
+    for (; p < end; p++) {
+        if (*p < '0' || *p > '9' || result > (LONG_MAX - (*p - '0')) / 10) {
+            return 0;
+        }
+        result = result * 10 + (*p - '0');
     }
     
-    // Get Departure Point
-    printf("Enter Departure Point: ");
-    fgets(newTrip.departurePoint, MAX_STRING, stdin);
-    newTrip.departurePoint[strcspn(newTrip.departurePoint, "\n")] = 0; // Remove newline
+    *value = result;
+    return 1;
+}
+
+// Parse a price field such as "350.50" (returns 0 if malformed)
+int parsePriceField(const Field *field, float *value) {
+    const char *p = field->start;
+    const char *end = p + field->length;
+    long long whole = 0;
+    long long fraction = 0;
+    long long scale = 1;
+    int digits = 0;
     
-    // Get Arrival Point
-    printf("Enter Arrival Point: ");
-    fgets(newTrip.arrivalPoint, MAX_STRING, stdin);
-    newTrip.arrivalPoint[strcspn(newTrip.arrivalPoint, "\n")] = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        whole = whole * 10 + (*p - '0');
+        if (whole > 1000000000LL) {
+            return 0;
+        }
+        digits++;
+    }
     
-    // Get Trip Date
-    printf("Enter Trip Date (DD/MM/YYYY): ");
-    fgets(newTrip.tripDate, MAX_STRING, stdin);
-    newTrip.tripDate[strcspn(newTrip.tripDate, "\n")] = 0;
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++) {
+            if (scale < 1000000LL) {
+                fraction = fraction * 10 + (*p - '0');
+                scale *= 10;
+            }
+            digits++;
+        }
+    }
     
-    // Get Departure Time
+    if (p != end || digits == 0) {
+        return 0;
+    }
+    
+    *value = (float)((double)whole + (double)fraction / (double)scale);
+    return 1;
+}
+
+// Copy a text field into a MAX_STRING buffer (returns 1 if it had to be cut)
+int copyTextField(char *dest, const Field *field) {
+    int length = field->length;
+    int truncated = 0;
+    
+    if (length > MAX_STRING - 1) {
+        length = MAX_STRING - 1;
+        truncated = 1;
+    }
+    
+    memcpy(dest, field->start, length);
+    dest[length] = '\0';
+    return truncated;
+}
+
+// Count the records (lines) in one loader slice
+void *countRecordsWorker(void *arg) {
+    LoadChunk *chunk = (LoadChunk *)arg;
+    int count = countNewlines(chunk->begin, chunk->end);
+    
+    // A last line without a trailing newline is still a record
+    if (chunk->end > chunk->begin && chunk->end[-1] != '\n') {
+        count++;
+    }
+    
+    chunk->recordCount = count;
+    return NULL;
+}
+
+// Parse the records of one loader slice into their final slots
+void *parseRecordsWorker(void *arg) {
+    LoadChunk *chunk = (LoadChunk *)arg;
+    const char *p = chunk->begin;
+    Field fields[MAX_FIELDS];
+    
+    for (int i = 0; i < chunk->recordCount; i++) {
+        int index = chunk->firstRecord + i;
+        if (index >= chunk->maxRecords) {
+            break;
+        }
+        
+        int fieldCount = splitFields(&p, chunk->end, fields);
+        if (fieldCount == 1 && fields[0].length == 0) {
+            chunk->status[index] = RECORD_BLANK;
+        } else {
+            chunk->status[index] = (signed char)chunk->parseRecord(
+                fields, fieldCount, chunk->records + (size_t)index * chunk->recordSize);
+        }
+    }
+    
+    return NULL;
+}
+
+// Split the line at *p into fields in a single pass over its bytes and
+// move *p past it (returns the field count; only MAX_FIELDS are kept)
+int splitFields(const char **p, const char *end, Field *fields) {
+    int fieldCount = 0;
+    const char *delimiter;
+    while (1) {
+        delimiter = findDelimiter(*p, end);
+        if (fieldCount < MAX_FIELDS) {
+            fields[fieldCount].start = *p;
+            fields[fieldCount].length = (int)(delimiter - *p);
+        }
+        fieldCount++;
+        *p = delimiter + 1;
+        if (delimiter >= end || *delimiter == '\n') {
+            break;
+        }
+    }
+    
+    // Tolerate CRLF line endings
+    Field *last = &fields[(fieldCount < MAX_FIELDS ? fieldCount : MAX_FIELDS) - 1];
+    if (last->length > 0 && last->start[last->length - 1] == '\r') {
+        last->length--;
+    }
+    return fieldCount;
+}
+
+// Run a worker over every chunk, one thread per chunk (chunk 0 runs on the caller)
+void runLoaderThreads(LoadChunk *chunks, int chunkCount, void *(*worker)(void *)) {
+    pthread_t threads[MAX_LOADER_THREADS];
+    int started[MAX_LOADER_THREADS] = {0};
+    
+    for (int i = 1; i < chunkCount; i++) {
+        started[i] = pthread_create(&threads[i], NULL, worker, &chunks[i]) == 0;
+        if (!started[i]) {
+            worker(&chunks[i]);
+        }
+    }
+    
+    worker(&chunks[0]);
+    
+    for (int i = 1; i < chunkCount; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+}
+
+// Load a pipe-delimited data file into a record array.
+// The file is read in one go, split into slices at line boundaries and parsed
+// concurrently; each record lands directly in its final slot. Returns the
+// number of records loaded, or -1 if the file does not exist.
+int loadRecordsFromFile(const char *filename, void *records, size_t recordSize, int maxRecords,
+                        int (*parseRecord)(const Field *fields, int fieldCount, void *record)) {
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        return -1;
+    }
+    
+    // Read the whole file into memory
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size < 0) {
+        fclose(file);
+        return 0;
+    }
+    
+    char *data = malloc(size + 1);
+    if (data == NULL) {
+        printf("Error: Not enough memory to load %s!\n", filename);
+        fclose(file);
+        return 0;
+    }
+    size = fread(data, 1, size, file);
+    data[size] = '\0';
+    fclose(file);
+    
+    // Skip the record count header, the lines themselves are authoritative
+    char *body = memchr(data, '\n', size);
+    body = body ? body + 1 : data + size;
+    char *end = data + size;
+    
+    // Decide how many threads the file is worth
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    long bySize = (end - body) / LOADER_MIN_CHUNK;
+    int chunkCount = cores < bySize ? (int)cores : (int)bySize;
+    if (chunkCount > MAX_LOADER_THREADS) chunkCount = MAX_LOADER_THREADS;
+    if (chunkCount < 1) chunkCount = 1;
+    
+    // Split into slices that start on record boundaries
+    LoadChunk chunks[MAX_LOADER_THREADS];
+    char *start = body;
+    for (int i = 0; i < chunkCount; i++) {
+        char *stop = end;
+        if (i < chunkCount - 1) {
+            stop = body + (end - body) * (i + 1) / chunkCount;
+            if (stop < start) {
+                stop = start;
+            }
+            char *newline = memchr(stop, '\n', end - stop);
+            stop = newline ? newline + 1 : end;
+        }
+        
+        chunks[i].begin = start;
+        chunks[i].end = stop;
+        chunks[i].maxRecords = maxRecords;
+        chunks[i].records = (char *)records;
+        chunks[i].recordSize = recordSize;
+        chunks[i].parseRecord = parseRecord;
+        start = stop;
+    }
+    
+    // Pass 1: count records per slice, then place each slice in the output
+    runLoaderThreads(chunks, chunkCount, countRecordsWorker);
+    int totalRecords = 0;
+    for (int i = 0; i < chunkCount; i++) {
+        chunks[i].firstRecord = totalRecords;
+        totalRecords += chunks[i].recordCount;
+    }
+    if (totalRecords > maxRecords) {
+        printf("Warning: %s has %d records, only the first %d were loaded.\n",
+               filename, totalRecords, maxRecords);
+        totalRecords = maxRecords;
+    }
+    
+    signed char *status = calloc(totalRecords > 0 ? totalRecords : 1, 1);
+    if (status == NULL) {
+        printf("Error: Not enough memory to load %s!\n", filename);
+        free(data);
+        return 0;
+    }
+    for (int i = 0; i < chunkCount; i++) {
+        chunks[i].status = status;
+    }
+    
+    // Pass 2: parse every slice in parallel
+    runLoaderThreads(chunks, chunkCount, parseRecordsWorker);
+    
+    // Report problems by line number and close the gaps left by skipped lines
+    int loaded = 0;
+    int problems = 0;
+    for (int i = 0; i < totalRecords; i++) {
+        int lineNumber = i + 2; // Line 1 is the record count
+        
+        if (status[i] < 0 || status[i] == RECORD_TRUNCATED) {
+            if (problems < MAX_REPORTED_ERRORS) {
+                printf("Warning: %s line %d: %s\n", filename, lineNumber,
+                       status[i] == RECORD_BAD_FIELD_COUNT ? "wrong number of fields, line skipped" :
+                       status[i] == RECORD_BAD_NUMBER ? "invalid number, line skipped" :
+                       "text field longer than allowed, value truncated");
+            }
+            problems++;
+        }
+        
+        if (status[i] == RECORD_OK || status[i] == RECORD_TRUNCATED) {
+            if (loaded != i) {
+                memcpy((char *)records + (size_t)loaded * recordSize,
+                       (char *)records + (size_t)i * recordSize, recordSize);
+            }
+            loaded++;
+        }
+    }
+    if (problems > MAX_REPORTED_ERRORS) {
+        printf("Warning: %d more problem line(s) in %s not shown.\n", problems - MAX_REPORTED_ERRORS, filename);
+    }
+    
+    free(status);
+    free(data);
+    return loaded;
+}
+
+// Hash an integer ID into a power-of-two table
+unsigned int hashID(int id, unsigned int tableSize) {
+    return ((unsigned int)id * 2654435761u) & (tableSize - 1);
+}
+
+// Rebuild every lookup index from the trip and ticket arrays
+void rebuildIndexes() {
+    for (int i = 0; i < TRIP_HASH_SIZE; i++) tripHashHead[i] = -1;
+    for (int i = 0; i < TICKET_HASH_SIZE; i++) ticketHashHead[i] = -1;
+    for (int i = 0; i < PASSENGER_HASH_SIZE; i++) idNumberHashHead[i] = -1;
+    for (int i = 0; i < PASSENGER_HASH_SIZE; i++) phoneHashHead[i] = -1;
+    trieReset(&passengerTrie);
+    trieReset(&driverTrie);
+    scheduleReset(&busSchedule);
+    scheduleReset(&driverSchedule);
+    resetConnections();
+    lastTicketID = archivedLastTicketID; // Archived IDs are never reused
+    
+    for (int i = 0; i < tripCount; i++) {
+        indexTrip(i);
+    }
+    for (int i = 0; i < ticketCount; i++) {
+        indexTicket(i);
+    }
+    
+    // Seat counts follow from the tickets actually on file
+    for (int i = 0; i < tripCount; i++) {
+        if (trips[i].isActive == 1) {
+            refreshAvailableSeats(i);
+        }
+    }
+}
+
+// Add a trip to the ID index
+void indexTrip(int tripIndex) {
+    unsigned int bucket = hashID(trips[tripIndex].tripID, TRIP_HASH_SIZE);
+    tripHashNext[tripIndex] = tripHashHead[bucket];
+    tripHashHead[bucket] = tripIndex;
+    
+    tripFirstTicket[tripIndex] = -1;
+    tripLastTicket[tripIndex] = -1;
+    memset(segmentSeats[tripIndex], 0, sizeof(segmentSeats[tripIndex]));
+    waitlistHead[tripIndex] = -1;
+    waitlistTail[tripIndex] = -1;
+    waitlistLength[tripIndex] = 0;
+    
+    if (trips[tripIndex].isActive == 1) {
+        trieInsertName(&driverTrie, trips[tripIndex].driverName, tripIndex);
+        scheduleTrip(tripIndex);
+        addConnection(tripIndex);
+    }
+}
+
+// Add a ticket to the ID index and, if active, to its trip's seat map
+void indexTicket(int ticketIndex) {
+    Ticket *ticket = &tickets[ticketIndex];
+    unsigned int bucket = hashID(ticket->ticketID, TICKET_HASH_SIZE);
+    ticketHashNext[ticketIndex] = ticketHashHead[bucket];
+    ticketHashHead[bucket] = ticketIndex;
+    ticketNextInTrip[ticketIndex] = -1;
+    
+    if (ticket->ticketID > lastTicketID) {
+        lastTicketID = ticket->ticketID;
+    }
+    
+    if (ticket->isActive == 1) {
+        linkTicket(ticketIndex);
+    }
+}
+
+// Add an active ticket to the passenger indexes and its trip's seat map
+void linkTicket(int ticketIndex) {
+    Ticket *ticket = &tickets[ticketIndex];
+    ticketNextInTrip[ticketIndex] = -1;
+    indexPassenger(ticketIndex);
+    
+    int tripIndex = findTripByID(ticket->tripID);
+    if (tripIndex == -1) {
+        return;
+    }
+    
+    if (tripLastTicket[tripIndex] == -1) {
+        tripFirstTicket[tripIndex] = ticketIndex;
+    } else {
+        ticketNextInTrip[tripLastTicket[tripIndex]] = ticketIndex;
+    }
+    tripLastTicket[tripIndex] = ticketIndex;
+    
+    // Tickets without a valid segment cover the whole route
+    int lastStop = getStopCount(tripIndex) - 1;
+    if (ticket->fromStop < 0 || ticket->toStop > lastStop || ticket->fromStop >= ticket->toStop) {
+        ticket->fromStop = 0;
+        ticket->toStop = lastStop;
+    }
+    
+    if (ticket->seatNumber >= 1 && ticket->seatNumber <= MAX_SEATS) {
+        for (int segment = ticket->fromStop; segment < ticket->toStop; segment++) {
+            segmentSeats[tripIndex][segment] |= 1ULL << (ticket->seatNumber - 1);
+        }
+    }
+}
+
+// Release an active ticket's seat and unlink it from its trip (call before cancelling)
+void unindexTicket(int ticketIndex) {
+    unlinkTicket(ticketIndex, &tickets[ticketIndex]);
+}
+
+// Undo linkTicket for a ticket slot that held the given record
+void unlinkTicket(int ticketIndex, const Ticket *ticket) {
+    unindexPassenger(ticketIndex, ticket);
+    
+    int tripIndex = findTripByID(ticket->tripID);
+    if (tripIndex == -1) {
+        return;
+    }
+    
+    int previous = -1;
+    for (int i = tripFirstTicket[tripIndex]; i != -1; i = ticketNextInTrip[i]) {
+        if (i == ticketIndex) {
+            if (previous == -1) {
+                tripFirstTicket[tripIndex] = ticketNextInTrip[i];
+            } else {
+                ticketNextInTrip[previous] = ticketNextInTrip[i];
+            }
+            if (tripLastTicket[tripIndex] == ticketIndex) {
+                tripLastTicket[tripIndex] = previous;
+            }
+            break;
+        }
+        previous = i;
+    }
+    
+    if (ticket->seatNumber >= 1 && ticket->seatNumber <= MAX_SEATS) {
+        for (int segment = ticket->fromStop; segment < ticket->toStop; segment++) {
+            segmentSeats[tripIndex][segment] &= ~(1ULL << (ticket->seatNumber - 1));
+        }
+    }
+}
+
+// Hash a string (FNV-1a) into a power-of-two table
+unsigned int hashString(const char *text, unsigned int tableSize) {
+    unsigned int hash = 2166136261u;
+    for (; *text; text++) {
+        hash = (hash ^ (unsigned char)*text) * 16777619u;
+    }
+    return hash & (tableSize - 1);
+}
+
+// Reduce a phone number to its national digits so "+90 555 ..." matches
+// "0555..."; any other number keeps all of its digits
+void makePhoneKey(const char *phone, char *key) {
+    char digits[MAX_STRING];
+    int count = 0;
+    
+    for (; *phone && count < MAX_STRING - 1; phone++) {
+        if (*phone >= '0' && *phone <= '9') {
+            digits[count++] = *phone;
+        }
+    }
+    
+    // Drop the international prefix, then the country code or trunk 0
+    int start = 0;
+    if (count >= 2 && digits[0] == '0' && digits[1] == '0') {
+        start = 2;
+    }
+    if (count - start == PHONE_KEY_DIGITS + 2 && digits[start] == '9' && digits[start + 1] == '0') {
+        start += 2;
+    } else if (count - start == PHONE_KEY_DIGITS + 1 && digits[start] == '0') {
+        start += 1;
+    }
+    memcpy(key, digits + start, count - start);
+    key[count - start] = '\0';
+}
+
+// A TC Kimlik number is 11 digits and never starts with 0
+int isIdNumber(const char *text) {
+    if (strlen(text) != 11 || text[0] == '0') {
+        return 0;
+    }
+    for (; *text; text++) {
+        if (*text < '0' || *text > '9') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Add an active ticket to the passenger ID number and phone indexes
+void indexPassenger(int ticketIndex) {
+    char phoneKey[MAX_STRING];
+    unsigned int bucket = hashString(tickets[ticketIndex].passenger.idNumber, PASSENGER_HASH_SIZE);
+    idNumberHashNext[ticketIndex] = idNumberHashHead[bucket];
+    idNumberHashHead[bucket] = ticketIndex;
+    
+    makePhoneKey(tickets[ticketIndex].passenger.phoneNumber, phoneKey);
+    bucket = hashString(phoneKey, PASSENGER_HASH_SIZE);
+    phoneHashNext[ticketIndex] = phoneHashHead[bucket];
+    phoneHashHead[bucket] = ticketIndex;
+    
+    trieInsertName(&passengerTrie, tickets[ticketIndex].passenger.fullName, ticketIndex);
+}
+
+// Remove a ticket slot holding the given record from the passenger indexes
+void unindexPassenger(int ticketIndex, const Ticket *ticket) {
+    char phoneKey[MAX_STRING];
+    unsigned int bucket = hashString(ticket->passenger.idNumber, PASSENGER_HASH_SIZE);
+    for (int *link = &idNumberHashHead[bucket]; *link != -1; link = &idNumberHashNext[*link]) {
+        if (*link == ticketIndex) {
+            *link = idNumberHashNext[ticketIndex];
+            break;
+        }
+    }
+    
+    makePhoneKey(ticket->passenger.phoneNumber, phoneKey);
+    bucket = hashString(phoneKey, PASSENGER_HASH_SIZE);
+    for (int *link = &phoneHashHead[bucket]; *link != -1; link = &phoneHashNext[*link]) {
+        if (*link == ticketIndex) {
+            *link = phoneHashNext[ticketIndex];
+            break;
+        }
+    }
+    
+    trieRemoveName(&passengerTrie, ticket->passenger.fullName, ticketIndex);
+}
+
+// Lower-case a UTF-8 name with Turkish rules (I -> ı, İ -> i) and
+// collapse runs of spaces, so stored names and queries compare byte-wise
+void foldName(const char *name, char *folded, size_t size) {
+    const unsigned char *p = (const unsigned char *)name;
+    size_t length = 0;
+    int pendingSpace = 0;
+    
+    while (*p && length + 3 < size) {
+        if (*p == ' ' || *p == '\t') {
+            pendingSpace = length > 0;
+            p++;
+            continue;
+        }
+        if (pendingSpace) {
+            folded[length++] = ' ';
+            pendingSpace = 0;
+        }
+        
+        if (*p == 'I') {
+            folded[length++] = (char)0xC4; // ı
+            folded[length++] = (char)0xB1;
+            p++;
+        } else if (*p >= 'A' && *p <= 'Z') {
+            folded[length++] = (char)(*p + ('a' - 'A'));
+            p++;
+        } else if (p[0] == 0xC4 && p[1] == 0xB0) {
+            folded[length++] = 'i'; // İ
+            p += 2;
+        } else if (p[0] == 0xC3 && (p[1] == 0x87 || p[1] == 0x96 || p[1] == 0x9C)) {
+            folded[length++] = (char)0xC3; // Ç Ö Ü -> ç ö ü
+            folded[length++] = (char)(p[1] + 0x20);
+            p += 2;
+        } else if ((p[0] == 0xC4 && p[1] == 0x9E) || (p[0] == 0xC5 && p[1] == 0x9E)) {
+            folded[length++] = (char)p[0]; // Ğ Ş -> ğ ş
+            folded[length++] = (char)0x9F;
+            p += 2;
+        } else {
+            folded[length++] = (char)*p++;
+        }
+    }
+    
+    folded[length] = '\0';
+}
+
+// Empty a trie, keeping its memory for reuse
+void trieReset(NameTrie *trie) {
+    if (trie->nodes == NULL) {
+        trie->nodeCapacity = 64;
+        trie->nodes = malloc(sizeof(TrieNode) * trie->nodeCapacity);
+        trie->labelCapacity = 1024;
+        trie->labels = malloc(trie->labelCapacity);
+        trie->postingCapacity = 64;
+        trie->postings = malloc(sizeof(TriePosting) * trie->postingCapacity);
+        if (trie->nodes == NULL || trie->labels == NULL || trie->postings == NULL) {
+            printf("Error: Not enough memory for the name index!\n");
+            exit(1);
+        }
+    }
+    
+    // Node 0 is the root with an empty label
+    trie->nodeCount = 1;
+    trie->nodes[0].labelStart = 0;
+    trie->nodes[0].labelLength = 0;
+    trie->nodes[0].firstChild = -1;
+    trie->nodes[0].nextSibling = -1;
+    trie->nodes[0].firstPosting = -1;
+    trie->labelSize = 0;
+    trie->postingCount = 0;
+    trie->freePosting = -1;
+}
+
+// Append a node (returns its index)
+int trieNewNode(NameTrie *trie, int labelStart, int labelLength) {
+    if (trie->nodeCount == trie->nodeCapacity) {
+        trie->nodeCapacity *= 2;
+        trie->nodes = realloc(trie->nodes, sizeof(TrieNode) * trie->nodeCapacity);
+        if (trie->nodes == NULL) {
+            printf("Error: Not enough memory for the name index!\n");
+            exit(1);
+        }
+    }
+    
+    TrieNode *node = &trie->nodes[trie->nodeCount];
+    node->labelStart = labelStart;
+    node->labelLength = labelLength;
+    node->firstChild = -1;
+    node->nextSibling = -1;
+    node->firstPosting = -1;
+    return trie->nodeCount++;
+}
+
+// Find the child whose label starts with a byte (returns -1 if none)
+int trieFindChild(const NameTrie *trie, int node, char first) {
+    for (int child = trie->nodes[node].firstChild; child != -1; child = trie->nodes[child].nextSibling) {
+        if (trie->labels[trie->nodes[child].labelStart] == first) {
+            return child;
+        }
+    }
+    return -1;
+}
+
+// Store a value under a key
+void trieInsert(NameTrie *trie, const char *key, int keyLength, int value) {
+    int node = 0;
+    int position = 0;
+    
+    while (position < keyLength) {
+        int child = trieFindChild(trie, node, key[position]);
+        
+        if (child == -1) {
+            // New leaf holding the rest of the key
+            if (trie->labelSize + keyLength - position > trie->labelCapacity) {
+                while (trie->labelSize + keyLength - position > trie->labelCapacity) {
+                    trie->labelCapacity *= 2;
+                }
+                trie->labels = realloc(trie->labels, trie->labelCapacity);
+                if (trie->labels == NULL) {
+                    printf("Error: Not enough memory for the name index!\n");
+                    exit(1);
+                }
+            }
+            memcpy(trie->labels + trie->labelSize, key + position, keyLength - position);
+            child = trieNewNode(trie, trie->labelSize, keyLength - position);
+            trie->labelSize += keyLength - position;
+            
+            trie->nodes[child].nextSibling = trie->nodes[node].firstChild;
+            trie->nodes[node].firstChild = child;
+            node = child;
+            break;
+        }
+        
+        // Match as much of the child's label as possible
+        int labelLength = trie->nodes[child].labelLength;
+        const char *label = trie->labels + trie->nodes[child].labelStart;
+        int common = 0;
+        while (common < labelLength && position + common < keyLength && label[common] == key[position + common]) {
+            common++;
+        }
+        
+        if (common < labelLength) {
+            // Split the edge; both halves keep pointing into the same label bytes
+            int middle = trieNewNode(trie, trie->nodes[child].labelStart, common);
+            trie->nodes[child].labelStart += common;
+            trie->nodes[child].labelLength -= common;
+            
+            // The middle node takes the child's place among its siblings
+            trie->nodes[middle].nextSibling = trie->nodes[child].nextSibling;
+            trie->nodes[middle].firstChild = child;
+            trie->nodes[child].nextSibling = -1;
+            int *link = &trie->nodes[node].firstChild;
+            while (*link != child) {
+                link = &trie->nodes[*link].nextSibling;
+            }
+            *link = middle;
+            child = middle;
+        }
+        
+        node = child;
+        position += common;
+    }
+    
+    // Attach the value
+    int posting;
+    if (trie->freePosting != -1) {
+        posting = trie->freePosting;
+        trie->freePosting = trie->postings[posting].next;
+    } else {
+        if (trie->postingCount == trie->postingCapacity) {
+            trie->postingCapacity *= 2;
+            trie->postings = realloc(trie->postings, sizeof(TriePosting) * trie->postingCapacity);
+            if (trie->postings == NULL) {
+                printf("Error: Not enough memory for the name index!\n");
+                exit(1);
+            }
+        }
+        posting = trie->postingCount++;
+    }
+    trie->postings[posting].value = value;
+    trie->postings[posting].next = trie->nodes[node].firstPosting;
+    trie->nodes[node].firstPosting = posting;
+}
+
+// Remove a value stored under a key (nodes are kept for reuse)
+void trieRemove(NameTrie *trie, const char *key, int keyLength, int value) {
+    int node = 0;
+    int position = 0;
+    
+    while (position < keyLength) {
+        node = trieFindChild(trie, node, key[position]);
+        if (node == -1 || trie->nodes[node].labelLength > keyLength - position ||
+            memcmp(trie->labels + trie->nodes[node].labelStart, key + position, trie->nodes[node].labelLength) != 0) {
+            return;
+        }
+        position += trie->nodes[node].labelLength;
+    }
+    
+    for (int *link = &trie->nodes[node].firstPosting; *link != -1; link = &trie->postings[*link].next) {
+        if (trie->postings[*link].value == value) {
+            int posting = *link;
+            *link = trie->postings[posting].next;
+            trie->postings[posting].next = trie->freePosting;
+            trie->freePosting = posting;
+            return;
+        }
+    }
+}
+
+// Index a name under its full form and under each later word,
+// so "yilmaz" finds "Mehmet Yilmaz" as well as "meh" does
+void trieInsertName(NameTrie *trie, const char *name, int value) {
+    char folded[MAX_FOLDED];
+    foldName(name, folded, sizeof(folded));
+    int length = (int)strlen(folded);
+    
+    for (int start = 0; start < length; start++) {
+        if (start == 0 || folded[start - 1] == ' ') {
+            trieInsert(trie, folded + start, length - start, value);
+        }
+    }
+}
+
+// Remove every key added by trieInsertName
+void trieRemoveName(NameTrie *trie, const char *name, int value) {
+    char folded[MAX_FOLDED];
+    foldName(name, folded, sizeof(folded));
+    int length = (int)strlen(folded);
+    
+    for (int start = 0; start < length; start++) {
+        if (start == 0 || folded[start - 1] == ' ') {
+            trieRemove(trie, folded + start, length - start, value);
+        }
+    }
+}
+
+// Position a cursor at the root (matches everything)
+void trieCursorStart(TrieCursor *cursor) {
+    cursor->node = 0;
+    cursor->matched = 0;
+    cursor->prefix[0] = '\0';
+}
+
+// Move a cursor to a longer folded prefix, continuing from where it stopped
+// when the new prefix extends the old one
+void trieCursorAdvance(const NameTrie *trie, TrieCursor *cursor, const char *folded) {
+    size_t consumed = strlen(cursor->prefix);
+    if (strncmp(folded, cursor->prefix, consumed) != 0) {
+        trieCursorStart(cursor);
+        consumed = 0;
+    }
+    
+    const char *rest = folded + consumed;
+    while (*rest && cursor->node != -1) {
+        TrieNode *node = &trie->nodes[cursor->node];
+        
+        if (cursor->matched < node->labelLength) {
+            // Still inside the current edge
+            if (trie->labels[node->labelStart + cursor->matched] != *rest) {
+                cursor->node = -1;
+                break;
+            }
+            cursor->matched++;
+            rest++;
+        } else {
+            // Take the child edge for the next byte
+            cursor->node = trieFindChild(trie, cursor->node, *rest);
+            cursor->matched = 0;
+        }
+    }
+    
+    strncpy(cursor->prefix, folded, MAX_FOLDED - 1);
+    cursor->prefix[MAX_FOLDED - 1] = '\0';
+}
+
+// Collect up to limit distinct values under a cursor (returns how many were found)
+int trieCollect(const NameTrie *trie, const TrieCursor *cursor, int *values, int limit) {
+    if (cursor->node == -1) {
+        return 0;
+    }
+    
+    int *stack = malloc(sizeof(int) * trie->nodeCount);
+    if (stack == NULL) {
+        return 0;
+    }
+    
+    int found = 0;
+    int depth = 0;
+    stack[depth++] = cursor->node;
+    
+    // Depth-first over the subtree, stopping as soon as the limit is reached
+    while (depth > 0 && found < limit) {
+        int node = stack[--depth];
+        
+        for (int posting = trie->nodes[node].firstPosting; posting != -1 && found < limit;
+             posting = trie->postings[posting].next) {
+            int value = trie->postings[posting].value;
+            int duplicate = 0;
+            for (int i = 0; i < found; i++) {
+                if (values[i] == value) {
+                    duplicate = 1;
+                    break;
+                }
+            }
+            if (!duplicate) {
+                values[found++] = value;
+            }
+        }
+        
+        for (int child = trie->nodes[node].firstChild; child != -1; child = trie->nodes[child].nextSibling) {
+            stack[depth++] = child;
+        }
+    }
+    
+    free(stack);
+    return found;
+}
+
+// Check whether a seat is sold on any segment between two stops
+int isSeatOccupied(int tripIndex, int seatNumber, int fromStop, int toStop) {
+    return (occupiedSeats(tripIndex, fromStop, toStop) >> (seatNumber - 1)) & 1;
+}
+
+// Number of stops on a trip, including departure and arrival points
+int getStopCount(int tripIndex) {
+    return getTripStops(tripIndex, NULL);
+}
+
+// Fill in the stop names of a trip in order (returns the stop count;
+// names may be NULL to count only)
+int getTripStops(int tripIndex, char names[][MAX_STRING]) {
+    int count = 0;
+    if (names != NULL) {
+        strcpy(names[count], trips[tripIndex].departurePoint);
+    }
+    count++;
+    
+    int middle = splitStops(trips[tripIndex].stops, names != NULL ? names + count : NULL, MAX_STOPS - 2, NULL);
+    count += middle < MAX_STOPS - 2 ? middle : MAX_STOPS - 2;
+    
+    if (names != NULL) {
+        strcpy(names[count], trips[tripIndex].arrivalPoint);
+    }
+    count++;
+    return count;
+}
+
+// Split a comma separated stop list into trimmed names, storing at most
+// limit of them (names may be NULL). Blank entries are skipped and
+// reported through blank; the count of names found is returned.
+int splitStops(const char *stops, char names[][MAX_STRING], int limit, int *blank) {
+    int count = 0;
+    const char *p = stops;
+    while (*p) {
+        size_t length = strcspn(p, ",");
+        
+        // Trim spaces around the name
+        const char *start = p;
+        const char *end = p + length;
+        while (start < end && *start == ' ') start++;
+        while (end > start && end[-1] == ' ') end--;
+        if (end - start >= MAX_STRING) end = start + MAX_STRING - 1;
+        
+        if (start == end) {
+            if (blank != NULL) *blank = 1;
+        } else {
+            if (names != NULL && count < limit) {
+                memcpy(names[count], start, end - start);
+                names[count][end - start] = '\0';
+            }
+            count++;
+        }
+        
+        p += length;
+        if (*p == ',') {
+            p++;
+            // A trailing comma leaves an empty last name
+            if (*p == '\0' && blank != NULL) *blank = 1;
+        }
+    }
+    return count;
+}
+
+// Ask for the boarding and leaving stops of a trip with intermediate stops
+// (returns 0 on invalid input); direct trips always use the whole route
+int readSegment(int tripIndex, int *fromStop, int *toStop) {
+    char names[MAX_STOPS][MAX_STRING];
+    int stopCount = getTripStops(tripIndex, names);
+    
+    *fromStop = 0;
+    *toStop = stopCount - 1;
+    if (stopCount == 2) {
+        return 1;
+    }
+    
+    printf("\n--- Stops ---\n");
+    for (int i = 0; i < stopCount; i++) {
+        printf("%d. %s\n", i + 1, names[i]);
+    }
+    
+    printf("Boarding Stop (1-%d): ", stopCount - 1);
+    scanf("%d", fromStop);
+    clearInputBuffer();
+    printf("Leaving Stop (%d-%d): ", *fromStop + 1, stopCount);
+    scanf("%d", toStop);
+    clearInputBuffer();
+    
+    // Convert to zero-based stop indexes
+    (*fromStop)--;
+    (*toStop)--;
+    if (*fromStop < 0 || *toStop >= stopCount || *fromStop >= *toStop) {
+        printf("Error: Invalid stops! The leaving stop must come after the boarding stop.\n");
+        return 0;
+    }
+    return 1;
+}
+
+// Check an intermediate stop list entered by the user (returns 0 if invalid)
+int validateStops(const char *stops) {
+    int blank = 0;
+    int count = splitStops(stops, NULL, 0, &blank);
+    
+    if (blank) {
+        printf("Error: Stop names cannot be empty!\n");
+        return 0;
+    }
+    if (count > MAX_STOPS - 2) {
+        printf("Error: A trip can have at most %d intermediate stops!\n", MAX_STOPS - 2);
+        return 0;
+    }
+    if (strchr(stops, '|') != NULL) {
+        printf("Error: Stop names cannot contain '|'!\n");
+        return 0;
+    }
+    return 1;
+}
+
+// Bitmap with one bit for each seat of a bus
+unsigned long long allSeatsMask(int totalSeats) {
+    return totalSeats >= 64 ? ~0ULL : (1ULL << totalSeats) - 1;
+}
+
+// Seats sold on any segment between two stops
+unsigned long long occupiedSeats(int tripIndex, int fromStop, int toStop) {
+    unsigned long long occupied = 0;
+    for (int segment = fromStop; segment < toStop; segment++) {
+        occupied |= segmentSeats[tripIndex][segment];
+    }
+    return occupied;
+}
+
+// Seats that are neither sold between two stops nor held
+unsigned long long freeSeatMap(int tripIndex, int fromStop, int toStop) {
+    return ~(occupiedSeats(tripIndex, fromStop, toStop) | heldSeatMap(tripIndex)) &
+           allSeatsMask(trips[tripIndex].totalSeats);
+}
+
+// Seats still for sale between two stops (held seats included)
+int availableSeatsFor(int tripIndex, int fromStop, int toStop) {
+    return trips[tripIndex].totalSeats - __builtin_popcountll(occupiedSeats(tripIndex, fromStop, toStop));
+}
+
+// Recompute a trip's availableSeats: seats free along the whole route
+void refreshAvailableSeats(int tripIndex) {
+    trips[tripIndex].availableSeats = availableSeatsFor(tripIndex, 0, getStopCount(tripIndex) - 1);
+}
+
+// Map the shared store, filling it from the data files if no other
+// counter is running, and claim a counter slot (returns 0 on failure)
+int openSharedStore() {
+    int fd = open(SHARED_STORE_FILE, O_RDWR | O_CREAT, 0666);
+    if (fd < 0) {
+        printf("Error: Could not open the shared store!\n");
+        return 0;
+    }
+    
+    // Only one counter sets the store up at a time
+    flock(fd, LOCK_EX);
+    
+    struct stat info;
+    int fresh = fstat(fd, &info) != 0 || info.st_size != (off_t)sizeof(SharedStore);
+    if (fresh && ftruncate(fd, sizeof(SharedStore)) != 0) {
+        printf("Error: Could not size the shared store!\n");
+        close(fd);
+        return 0;
+    }
+    
+    void *memory = mmap(NULL, sizeof(SharedStore), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+        printf("Error: Could not map the shared store!\n");
+        close(fd);
+        return 0;
+    }
+    sharedStore = (SharedStore *)memory;
+    trips = sharedStore->trips;
+    tickets = sharedStore->tickets;
+    templates = sharedStore->templates;
+    
+    // No trip has a waitlist until this counter's file is loaded
+    for (int i = 0; i < MAX_TRIPS; i++) {
+        waitlistHead[i] = -1;
+        waitlistTail[i] = -1;
+        waitlistLength[i] = 0;
+    }
+    
+    // A store nobody is using may be stale; the files are authoritative then
+    if (sharedStore->magic != SHARED_STORE_MAGIC || sharedStore->storeSize != sizeof(SharedStore)) {
+        fresh = 1;
+    }
+    if (!fresh) {
+        fresh = 1;
+        for (int i = 0; i < MAX_COUNTERS; i++) {
+            if (sharedStore->counterPid[i] != 0 && isCounterAlive(sharedStore->counterPid[i])) {
+                fresh = 0;
+            }
+        }
+    }
+    
+    if (fresh) {
+        memset(sharedStore, 0, sizeof(SharedStore));
+        
+        pthread_mutexattr_t attributes;
+        pthread_mutexattr_init(&attributes);
+        pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&sharedStore->lock, &attributes);
+        pthread_mutex_init(&sharedStore->saveLock, &attributes);
+        pthread_mutexattr_destroy(&attributes);
+        
+        loadTripsFromFile();
+        loadTicketsFromFile();
+        loadTemplatesFromFile();
+        sharedStore->tripCount = tripCount;
+        sharedStore->ticketCount = ticketCount;
+        sharedStore->templateCount = templateCount;
+        sharedStore->tripJournalCount = tripJournalCount;
+        sharedStore->storeSize = sizeof(SharedStore);
+        sharedStore->magic = SHARED_STORE_MAGIC;
+    }
+    
+    lockSharedStore();
+    
+    // Take the first free slot; slots of stopped counters are reused
+    counterSlot = -1;
+    for (int i = 0; i < MAX_COUNTERS && counterSlot == -1; i++) {
+        if (sharedStore->counterPid[i] == 0 || !isCounterAlive(sharedStore->counterPid[i])) {
+            counterSlot = i;
+        }
+    }
+    if (counterSlot == -1) {
+        printf("Error: All %d counters are already in use!\n", MAX_COUNTERS);
+        unlockSharedStore();
+        flock(fd, LOCK_UN);
+        close(fd);
+        trips = ownTrips;
+        tickets = ownTickets;
+        templates = ownTemplates;
+        munmap(sharedStore, sizeof(SharedStore));
+        sharedStore = NULL;
+        return 0;
+    }
+    sharedStore->counterPid[counterSlot] = getpid();
+    memset(sharedStore->heldSeats[counterSlot], 0, sizeof(sharedStore->heldSeats[counterSlot]));
+    
+    // Counter 1 keeps the usual waitlist file
+    if (counterSlot > 0) {
+        snprintf(waitlistFile, sizeof(waitlistFile), "waitlist%d.txt", counterSlot + 1);
+    }
+    
+    reindexSharedStore();
+    unlockSharedStore();
+    
+    flock(fd, LOCK_UN);
+    close(fd);
+    
+    printf("Shared mode: counter %d, %d trips and %d tickets in the store.\n",
+           counterSlot + 1, tripCount, ticketCount);
+    return 1;
+}
+
+// Give up this counter's slot and its seat holds
+void closeSharedStore() {
+    if (sharedStore == NULL) {
+        return;
+    }
+    
+    // The store goes away with the last counter; keep working on a copy
+    lockSharedStore();
+    memset(sharedStore->heldSeats[counterSlot], 0, sizeof(sharedStore->heldSeats[counterSlot]));
+    sharedStore->counterPid[counterSlot] = 0;
+    memcpy(ownTrips, trips, sizeof(Trip) * tripCount);
+    memcpy(ownTickets, tickets, sizeof(Ticket) * ticketCount);
+    memcpy(ownTemplates, templates, sizeof(TripTemplate) * templateCount);
+    unlockSharedStore();
+    
+    trips = ownTrips;
+    tickets = ownTickets;
+    templates = ownTemplates;
+    munmap(sharedStore, sizeof(SharedStore));
+    sharedStore = NULL;
+}
+
+// Take the store lock, recovering the store if its owner died while holding it
+void lockSharedStore() {
+    int result = pthread_mutex_lock(&sharedStore->lock);
+    if (result != 0 && result != EOWNERDEAD) {
+        printf("Error: The shared store cannot be locked!\n");
+        exit(1);
+    }
+    sharedLocked = 1;
+    
+    if (result == EOWNERDEAD) {
+        // The store keeps whatever part of its change the counter made. Every
+        // counter indexes it again (seat counts follow from the tickets) and
+        // the files are written from it.
+        pthread_mutex_consistent(&sharedStore->lock);
+        printf("Warning: Another counter stopped during an update, checking and saving the shared data again.\n");
+        sharedStore->version++;
+        sharedStore->rebuildVersion = sharedStore->version;
+        sharedStore->tripsSavedVersion = 0;
+        sharedStore->ticketsSavedVersion = 0;
+        sharedStore->templatesSavedVersion = 0;
+        pendingSaves |= SAVE_TRIPS | SAVE_TICKETS | SAVE_TEMPLATES;
+    }
+}
+
+// Let the other counters continue, then write the files the change asked for
+void unlockSharedStore() {
+    sharedLocked = 0;
+    pthread_mutex_unlock(&sharedStore->lock);
+    flushSaves();
+}
+
+// Take the lock counters write the data files and the trip journal under
+// (after the store lock, never before it) and the journal's line count
+void lockSavedFiles() {
+    if (sharedStore == NULL) {
+        return;
+    }
+    if (pthread_mutex_lock(&sharedStore->saveLock) == EOWNERDEAD) {
+        // Files are renamed into place whole; a cut-off journal line is skipped when loading
+        pthread_mutex_consistent(&sharedStore->saveLock);
+    }
+    tripJournalCount = sharedStore->tripJournalCount;
+}
+
+// Release the file lock, handing the journal's line count back
+void unlockSavedFiles() {
+    if (sharedStore == NULL) {
+        return;
+    }
+    sharedStore->tripJournalCount = tripJournalCount;
+    pthread_mutex_unlock(&sharedStore->saveLock);
+}
+
+// Ask for SAVE_* files to be written: at once, or once this counter
+// releases the store lock so other counters are not kept waiting
+void requestSave(int files) {
+    pendingSaves |= files;
+    if (!sharedLocked) {
+        flushSaves();
+    }
+}
+
+// Write the files asked for. A shared file is written from the store as
+// it is now, unless another counter already wrote this version of it.
+void flushSaves() {
+    int files = pendingSaves;
+    pendingSaves = 0;
+    
+    if (files & SAVE_WAITLIST) {
+        writeWaitlistFile();
+    }
+    if (sharedStore == NULL) {
+        if (files & SAVE_TRIPS) writeTripsFile(tripCount);
+        if (files & SAVE_TICKETS) writeTicketsFile(ticketCount);
+        if (files & SAVE_TEMPLATES) writeTemplatesFile(templateCount);
+        return;
+    }
+    if (!(files & (SAVE_TRIPS | SAVE_TICKETS | SAVE_TEMPLATES))) {
+        return;
+    }
+    
+    lockSavedFiles();
+    // The counts are published before the version that covers them
+    unsigned long version = __atomic_load_n(&sharedStore->version, __ATOMIC_ACQUIRE);
+    if ((files & SAVE_TRIPS) && sharedStore->tripsSavedVersion < version &&
+        writeTripsFile(sharedStore->tripCount)) {
+        sharedStore->tripsSavedVersion = version;
+    }
+    if ((files & SAVE_TICKETS) && sharedStore->ticketsSavedVersion < version &&
+        writeTicketsFile(sharedStore->ticketCount)) {
+        sharedStore->ticketsSavedVersion = version;
+    }
+    if ((files & SAVE_TEMPLATES) && sharedStore->templatesSavedVersion < version &&
+        writeTemplatesFile(sharedStore->templateCount)) {
+        sharedStore->templatesSavedVersion = version;
+    }
+    unlockSavedFiles();
+}
+
+// Index the whole store again (call with the lock held). Waitlists belong
+// to this counter and are kept; trips new to it start with empty queues.
+void reindexSharedStore() {
+    tripCount = sharedStore->tripCount;
+    ticketCount = sharedStore->ticketCount;
+    templateCount = sharedStore->templateCount;
+    
+    int head[MAX_TRIPS], tail[MAX_TRIPS], length[MAX_TRIPS];
+    memcpy(head, waitlistHead, sizeof(int) * tripCount);
+    memcpy(tail, waitlistTail, sizeof(int) * tripCount);
+    memcpy(length, waitlistLength, sizeof(int) * tripCount);
+    refreshArchiveIndex();
+    rebuildIndexes();
+    memcpy(waitlistHead, head, sizeof(int) * tripCount);
+    memcpy(waitlistTail, tail, sizeof(int) * tripCount);
+    memcpy(waitlistLength, length, sizeof(int) * tripCount);
+    
+    memcpy(indexedTrips, trips, sizeof(Trip) * tripCount);
+    memcpy(indexedTickets, tickets, sizeof(Ticket) * ticketCount);
+    memcpy(indexedTemplates, templates, sizeof(TripTemplate) * templateCount);
+    sharedVersion = sharedStore->version;
+    
+    int dropped = 0;
+    for (int i = 0; i < tripCount; i++) {
+        if (trips[i].isActive != 1) {
+            dropped |= forgetDeletedTrip(i);
+        }
+    }
+    if (dropped) {
+        saveWaitlistToFile();
+    }
+}
+
+// Bring this counter's indexes up to the store's version (call with the
+// lock held). Only the slots logged since its last look are indexed again.
+void pullSharedStore() {
+    unsigned long version = sharedStore->version;
+    if (version == sharedVersion) {
+        return;
+    }
+    if (sharedStore->rebuildVersion > sharedVersion || version - sharedVersion > SHARED_LOG_SIZE) {
+        reindexSharedStore();
+        return;
+    }
+    
+    static char tripChanged[MAX_TRIPS], ticketChanged[MAX_TICKETS];
+    int changedTrips[SHARED_LOG_SIZE], changedTickets[SHARED_LOG_SIZE];
+    int changedTripCount = 0, changedTicketCount = 0;
+    for (unsigned long v = sharedVersion + 1; v <= version; v++) {
+        const SharedChange *change = &sharedStore->changes[v % SHARED_LOG_SIZE];
+        if (change->kind == CHANGE_TRIP && change->index < tripCount && !tripChanged[change->index]) {
+            tripChanged[change->index] = 1;
+            changedTrips[changedTripCount++] = change->index;
+        } else if (change->kind == CHANGE_TICKET && change->index < ticketCount &&
+                   !ticketChanged[change->index]) {
+            ticketChanged[change->index] = 1;
+            changedTickets[changedTicketCount++] = change->index;
+        }
+    }
+    
+    // Moved tickets come out as this counter indexed them, while their trips are still linked
+    char moved[SHARED_LOG_SIZE];
+    for (int c = 0; c < changedTicketCount; c++) {
+        int k = changedTickets[c];
+        moved[c] = isTicketMoved(&indexedTickets[k], &tickets[k]);
+        if (moved[c] && indexedTickets[k].isActive == 1) {
+            unlinkTicket(k, &indexedTickets[k]);
+        }
+    }
+    
+    // Trips changed beyond their seat count are indexed again
+    int dropped = 0;
+    for (int c = 0; c < changedTripCount; c++) {
+        int i = changedTrips[c];
+        const Trip *old = &indexedTrips[i];
+        Trip compare;
+        memcpy(&compare, old, sizeof(Trip));
+        compare.availableSeats = trips[i].availableSeats;
+        if (memcmp(&compare, &trips[i], sizeof(Trip)) != 0) {
+            if (old->isActive == 1) {
+                trieRemoveName(&driverTrie, old->driverName, i);
+                unscheduleTrip(i);
+                removeConnection(i);
+            }
+            if (trips[i].isActive == 1) {
+                trieInsertName(&driverTrie, trips[i].driverName, i);
+                scheduleTrip(i);
+                addConnection(i);
+            }
+        }
+        if (old->isActive == 1 && trips[i].isActive != 1) {
+            tripFirstTicket[i] = -1;
+            tripLastTicket[i] = -1;
+            memset(segmentSeats[i], 0, sizeof(segmentSeats[i]));
+            dropped |= forgetDeletedTrip(i);
+        }
+        indexedTrips[i] = trips[i];
+        tripChanged[i] = 0;
+    }
+    while (tripCount < sharedStore->tripCount) {
+        indexTrip(tripCount);
+        indexedTrips[tripCount] = trips[tripCount];
+        tripCount++;
+    }
+    
+    for (int c = 0; c < changedTicketCount; c++) {
+        int k = changedTickets[c];
+        if (moved[c] && tickets[k].isActive == 1) {
+            linkTicket(k);
+        }
+        indexedTickets[k] = tickets[k];
+        ticketChanged[k] = 0;
+    }
+    while (ticketCount < sharedStore->ticketCount) {
+        indexTicket(ticketCount);
+        indexedTickets[ticketCount] = tickets[ticketCount];
+        ticketCount++;
+    }
+    
+    templateCount = sharedStore->templateCount;
+    memcpy(indexedTemplates, templates, sizeof(TripTemplate) * templateCount);
+    sharedVersion = version;
+    
+    if (dropped) {
+        saveWaitlistToFile();
+    }
+}
+
+// Whether a ticket's change touches the indexes: its passenger, trip, seat
+// or segment, or whether it is active
+int isTicketMoved(const Ticket *old, const Ticket *ticket) {
+    return old->isActive != ticket->isActive || old->tripID != ticket->tripID ||
+           old->seatNumber != ticket->seatNumber || old->fromStop != ticket->fromStop ||
+           old->toStop != ticket->toStop ||
+           strcmp(old->passenger.fullName, ticket->passenger.fullName) != 0 ||
+           strcmp(old->passenger.idNumber, ticket->passenger.idNumber) != 0 ||
+           strcmp(old->passenger.phoneNumber, ticket->passenger.phoneNumber) != 0;
+}
+
+// Drop this counter's holds and waiting passengers on a trip deleted
+// elsewhere (returns 1 if its waitlist changed)
+int forgetDeletedTrip(int tripIndex) {
+    int dropped = 0;
+    if (waitlistLength[tripIndex] > 0) {
+        clearWaitlist(tripIndex);
+        dropped = 1;
+    }
+    for (int h = 0; heldMap[tripIndex] != 0 && h < holdCount; h++) {
+        if (holds[h].isActive && holds[h].tripIndex == tripIndex) {
+            releaseHold(h);
+        }
+    }
+    return dropped;
+}
+
+// Log every slot this counter changed, those that differ from how it
+// last indexed them, and publish the new counts (call with the lock held)
+void logSharedChanges() {
+    unsigned long version = sharedStore->version;
+    
+    if (tripCount < sharedStore->tripCount || ticketCount < sharedStore->ticketCount ||
+        templateCount < sharedStore->templateCount) {
+        // Slots were moved (archiving); the other counters index everything again
+        version++;
+        sharedStore->rebuildVersion = version;
+        memcpy(indexedTrips, trips, sizeof(Trip) * tripCount);
+        memcpy(indexedTickets, tickets, sizeof(Ticket) * ticketCount);
+        memcpy(indexedTemplates, templates, sizeof(TripTemplate) * templateCount);
+    } else {
+        for (int i = 0; i < tripCount; i++) {
+            if (i >= sharedStore->tripCount || memcmp(&trips[i], &indexedTrips[i], sizeof(Trip)) != 0) {
+                version++;
+                sharedStore->changes[version % SHARED_LOG_SIZE] = (SharedChange){CHANGE_TRIP, i};
+                indexedTrips[i] = trips[i];
+            }
+        }
+        for (int i = 0; i < ticketCount; i++) {
+            if (i >= sharedStore->ticketCount || memcmp(&tickets[i], &indexedTickets[i], sizeof(Ticket)) != 0) {
+                version++;
+                sharedStore->changes[version % SHARED_LOG_SIZE] = (SharedChange){CHANGE_TICKET, i};
+                indexedTickets[i] = tickets[i];
+            }
+        }
+        for (int i = 0; i < templateCount; i++) {
+            if (i >= sharedStore->templateCount ||
+                memcmp(&templates[i], &indexedTemplates[i], sizeof(TripTemplate)) != 0) {
+                version++;
+                sharedStore->changes[version % SHARED_LOG_SIZE] = (SharedChange){CHANGE_TEMPLATE, i};
+                indexedTemplates[i] = templates[i];
+            }
+        }
+    }
+    
+    sharedStore->tripCount = tripCount;
+    sharedStore->ticketCount = ticketCount;
+    sharedStore->templateCount = templateCount;
+    __atomic_store_n(&sharedStore->version, version, __ATOMIC_RELEASE);
+    sharedVersion = version;
+}
+
+// Lock the store and bring the local indexes up to date before a change
+void beginSharedUpdate() {
+    if (sharedStore == NULL) {
+        return;
+    }
+    lockSharedStore();
+    pullSharedStore();
+}
+
+// Log the change (if any), let the other counters continue and save
+void endSharedUpdate(int changed) {
+    if (sharedStore == NULL) {
+        return;
+    }
+    if (changed) {
+        logSharedChanges();
+    }
+    unlockSharedStore();
+}
+
+// Catch up with the other counters, free the slots of stopped ones and
+// give seats they released to this counter's waiting passengers
+void syncSharedStore() {
+    if (sharedStore == NULL) {
+        return;
+    }
+    lockSharedStore();
+    
+    for (int i = 0; i < MAX_COUNTERS; i++) {
+        if (i != counterSlot && sharedStore->counterPid[i] != 0 && !isCounterAlive(sharedStore->counterPid[i])) {
+            memset(sharedStore->heldSeats[i], 0, sizeof(sharedStore->heldSeats[i]));
+            sharedStore->counterPid[i] = 0;
+        }
+    }
+    
+    unsigned long before = sharedVersion;
+    pullSharedStore();
+    
+    int promoted = 0;
+    if (sharedVersion != before) {
+        for (int i = 0; i < tripCount; i++) {
+            if (waitlistHead[i] != -1 && trips[i].isActive == 1) {
+                promoted += promoteFromWaitlist(i);
+            }
+        }
+    }
+    if (promoted > 0) {
+        saveTicketsToFile();
+        saveTripsToFile();
+        saveWaitlistToFile();
+        logSharedChanges();
+    }
+    
+    unlockSharedStore();
+}
+
+// Check whether a counter's process is still running
+int isCounterAlive(pid_t pid) {
+    return kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+// Let the other counters see this counter's holds on a trip
+void publishHeldSeats(int tripIndex) {
+    if (sharedStore != NULL) {
+        __atomic_store_n(&sharedStore->heldSeats[counterSlot][tripIndex], heldMap[tripIndex], __ATOMIC_RELEASE);
+    }
+}
+
+// Seats held on a trip at this or any other counter
+unsigned long long heldSeatMap(int tripIndex) {
+    unsigned long long held = heldMap[tripIndex];
+    if (sharedStore != NULL) {
+        for (int i = 0; i < MAX_COUNTERS; i++) {
+            if (i != counterSlot) {
+                held |= __atomic_load_n(&sharedStore->heldSeats[i][tripIndex], __ATOMIC_ACQUIRE);
+            }
+        }
+    }
+    return held;
+}
+
+// Find trip by ID (returns index, -1 if not found)
+int findTripByID(int tripID) {
+    for (int i = tripHashHead[hashID(tripID, TRIP_HASH_SIZE)]; i != -1; i = tripHashNext[i]) {
+        if (trips[i].tripID == tripID && trips[i].isActive == 1) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Find ticket by ID (returns index, -1 if not found)
+int findTicketByID(int ticketID) {
+    for (int i = ticketHashHead[hashID(ticketID, TICKET_HASH_SIZE)]; i != -1; i = ticketHashNext[i]) {
+        if (tickets[i].ticketID == ticketID && tickets[i].isActive == 1) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Create a new trip
+void createTrip() {
+    printf("\n========================================\n");
+    printf("         CREATE NEW TRIP\n");
+    printf("========================================\n");
+    
+    // Check if we have space for more trips
+    if (tripCount >= MAX_TRIPS) {
+        printf("Error: Maximum trip limit reached!\n");
+        return;
+    }
+    
+    Trip newTrip;
+    
+    // Get Trip ID
+    printf("Enter Trip ID: ");
+    scanf("%d", &newTrip.tripID);
+    clearInputBuffer();
+    
+    // Check if Trip ID already exists
+    if (findTripByID(newTrip.tripID) != -1) {
+        printf("Error: A trip with ID %d already exists!\n", newTrip.tripID);
+        return;
+    }
+    if (isArchivedTrip(newTrip.tripID)) {
+        printf("Error: Trip ID %d belongs to an archived trip!\n", newTrip.tripID);
+        return;
+    }
+    if (newTrip.tripID >= RECURRING_ID_BASE) {
+        printf("Error: Trip IDs from %d on belong to recurring trips!\n", RECURRING_ID_BASE);
+        return;
+    }
+    
+    // Get Departure Point
+    printf("Enter Departure Point: ");
+    fgets(newTrip.departurePoint, MAX_STRING, stdin);
+    newTrip.departurePoint[strcspn(newTrip.departurePoint, "\n")] = 0; // Remove newline
+    
+    // Get Arrival Point
+    printf("Enter Arrival Point: ");
+    fgets(newTrip.arrivalPoint, MAX_STRING, stdin);
+    newTrip.arrivalPoint[strcspn(newTrip.arrivalPoint, "\n")] = 0;
+    
+    // Get Intermediate Stops
+    printf("Enter Intermediate Stops (comma separated, empty for none): ");
+    fgets(newTrip.stops, MAX_STRING, stdin);
+    newTrip.stops[strcspn(newTrip.stops, "\n")] = 0;
+    if (!validateStops(newTrip.stops)) {
+        return;
+    }
+    
+    // Get Trip Date
+    printf("Enter Trip Date (DD/MM/YYYY): ");
+    fgets(newTrip.tripDate, MAX_STRING, stdin);
+    newTrip.tripDate[strcspn(newTrip.tripDate, "\n")] = 0;
+    
+    // Get Departure Time
+    printf("Enter Departure Time (HH:MM): ");
+    fgets(newTrip.departureTime, MAX_STRING, stdin);
+    newTrip.departureTime[strcspn(newTrip.departureTime, "\n")] = 0;
+    
+    // Get Arrival Time
+    printf("Enter Arrival Time (HH:MM): ");
+    fgets(newTrip.arrivalTime, MAX_STRING, stdin);
+    newTrip.arrivalTime[strcspn(newTrip.arrivalTime, "\n")] = 0;
+    
+    // Validate the times, the bus and driver schedules depend on them
+    int day, minutes;
+    if (!parseDate(newTrip.tripDate, &day)) {
+        printf("Error: Invalid date! Use DD/MM/YYYY.\n");
+        return;
+    }
+    if (!parseTime(newTrip.departureTime, &minutes) || !parseTime(newTrip.arrivalTime, &minutes)) {
+        printf("Error: Invalid time! Use HH:MM.\n");
+        return;
+    }
+    
+    // Get Bus License Plate
+    printf("Enter Bus License Plate: ");
+    fgets(newTrip.busLicensePlate, MAX_STRING, stdin);
+    newTrip.busLicensePlate[strcspn(newTrip.busLicensePlate, "\n")] = 0;
+    
+    // Get Driver's Full Name
+    printf("Enter Driver's Full Name: ");
+    fgets(newTrip.driverName, MAX_STRING, stdin);
+    newTrip.driverName[strcspn(newTrip.driverName, "\n")] = 0;
+    
+    // The bus and the driver must be free for the whole trip
+    if (!checkScheduleConflicts(&newTrip, -1)) {
+        return;
+    }
+    
+    // Get Number of Seats
+    printf("Enter Number of Seats: ");
+    scanf("%d", &newTrip.totalSeats);
+    clearInputBuffer();
+    
+    // Validate seat count
+    if (newTrip.totalSeats <= 0 || newTrip.totalSeats > MAX_SEATS) {
+        printf("Error: Invalid number of seats! Must be between 1 and %d.\n", MAX_SEATS);
+        return;
+    }
+    
+    // Get Ticket Price
+    printf("Enter Ticket Price: ");
+    scanf("%f", &newTrip.ticketPrice);
+    clearInputBuffer();
+    
+    // Validate price
+    if (newTrip.ticketPrice <= 0) {
+        printf("Error: Ticket price must be greater than 0!\n");
+        return;
+    }
+    
+    // Set initial values
+    newTrip.availableSeats = newTrip.totalSeats; // All seats available initially
+    newTrip.isActive = 1; // Trip is active
+    
+    // Another counter may have used the ID or the last slot meanwhile
+    beginSharedUpdate();
+    if (tripCount >= MAX_TRIPS || findTripByID(newTrip.tripID) != -1) {
+        printf("Error: Trip ID %d was just taken at another counter!\n", newTrip.tripID);
+        endSharedUpdate(0);
+        return;
+    }
+    if (!checkScheduleConflicts(&newTrip, -1)) {
+        endSharedUpdate(0);
+        return;
+    }
+    
+    // Add trip to array
+    trips[tripCount] = newTrip;
+    indexTrip(tripCount);
+    tripCount++;
+    
+    // Save to file
+    saveTripsToFile();
+    endSharedUpdate(1);
+    
+    printf("\n✓ Trip created successfully!\n");
+    printf("Trip ID: %d\n", newTrip.tripID);
+    printf("Route: %s -> %s\n", newTrip.departurePoint, newTrip.arrivalPoint);
+    printf("Date: %s at %s\n", newTrip.tripDate, newTrip.departureTime);
+}
+
+// Copy the fields named in a FIELD_* mask from one trip to another
+void applyTripChanges(Trip *trip, const Trip *changed, int mask) {
+    if (mask & FIELD_DEPARTURE_POINT) strcpy(trip->departurePoint, changed->departurePoint);
+    if (mask & FIELD_ARRIVAL_POINT) strcpy(trip->arrivalPoint, changed->arrivalPoint);
+    if (mask & FIELD_TRIP_DATE) strcpy(trip->tripDate, changed->tripDate);
+    if (mask & FIELD_DEPARTURE_TIME) strcpy(trip->departureTime, changed->departureTime);
+    if (mask & FIELD_BUS) strcpy(trip->busLicensePlate, changed->busLicensePlate);
+    if (mask & FIELD_DRIVER) strcpy(trip->driverName, changed->driverName);
+    if (mask & FIELD_SEATS) {
+        trip->totalSeats = changed->totalSeats;
+        trip->availableSeats = changed->availableSeats;
+    }
+    if (mask & FIELD_PRICE) trip->ticketPrice = changed->ticketPrice;
+    if (mask & FIELD_STOPS) strcpy(trip->stops, changed->stops);
+    if (mask & FIELD_ARRIVAL_TIME) strcpy(trip->arrivalTime, changed->arrivalTime);
+}
+
+// Check a whole change set against the trip's current sales (returns 0
+// after reporting every problem found)
+int validateTripChanges(int tripIndex, const Trip *changed, int mask) {
+    int valid = 1;
+    
+    if (mask & FIELD_SEATS) {
+        // Check if new seat count is less than sold tickets
+        int soldSeats = trips[tripIndex].totalSeats - trips[tripIndex].availableSeats;
+        if (changed->totalSeats < soldSeats) {
+            printf("Error: Cannot reduce seats below %d (already sold tickets)!\n", soldSeats);
+            valid = 0;
+        }
+        
+        // Sold or held seat numbers must still exist on the new bus
+        unsigned long long usedSeats = occupiedSeats(tripIndex, 0, getStopCount(tripIndex) - 1) | heldSeatMap(tripIndex);
+        int highestSeat = usedSeats ? 64 - __builtin_clzll(usedSeats) : 0;
+        if (changed->totalSeats < highestSeat) {
+            printf("Error: Cannot reduce seats below %d (seat %d is taken)!\n", highestSeat, highestSeat);
+            valid = 0;
+        }
+    }
+    
+    if ((mask & FIELD_PRICE) && changed->ticketPrice <= 0) {
+        printf("Error: Price must be greater than 0!\n");
+        valid = 0;
+    }
+    
+    // Segments of existing tickets and waitlist requests depend on the stops
+    if ((mask & FIELD_STOPS) && (tripFirstTicket[tripIndex] != -1 || waitlistLength[tripIndex] > 0)) {
+        printf("Error: Stops cannot be changed after tickets are sold!\n");
+        valid = 0;
+    }
+    
+    // Date, time, bus and driver changes are checked together against the schedules
+    if ((mask & FIELD_SCHEDULE) && !checkScheduleConflicts(changed, tripIndex)) {
+        valid = 0;
+    }
+    return valid;
+}
+
+// Validate a change set against the current trip and apply it in one step.
+// Returns 1 if the trip was updated.
+int commitTripChanges(int tripID, const Trip *changed, int mask) {
+    // Other counters may have sold seats while the changes were entered
+    beginSharedUpdate();
+    
+    int index = findTripByID(tripID);
+    if (index == -1 || trips[index].isActive != 1) {
+        printf("Error: Trip with ID %d not found!\n", tripID);
+        endSharedUpdate(0);
+        return 0;
+    }
+    
+    Trip updated = trips[index];
+    applyTripChanges(&updated, changed, mask);
+    if (!validateTripChanges(index, &updated, mask)) {
+        endSharedUpdate(0);
+        return 0;
+    }
+    
+    // Indexes keyed on the changed fields are updated once for the whole set
+    if (mask & FIELD_DRIVER) {
+        trieRemoveName(&driverTrie, trips[index].driverName, index);
+    }
+    if (mask & FIELD_SCHEDULE) {
+        unscheduleTrip(index);
+    }
+    if (mask & FIELD_CONNECTION) {
+        removeConnection(index);
+    }
+    trips[index] = updated;
+    if (mask & FIELD_SCHEDULE) {
+        scheduleTrip(index);
+    }
+    if (mask & FIELD_CONNECTION) {
+        addConnection(index);
+    }
+    if (mask & FIELD_DRIVER) {
+        trieInsertName(&driverTrie, trips[index].driverName, index);
+    }
+    
+    int promoted = 0;
+    if (mask & FIELD_SEATS) {
+        refreshAvailableSeats(index);
+        
+        // New seats go to the waitlist first
+        promoted = promoteFromWaitlist(index);
+    }
+    
+    if (promoted > 0) {
+        saveTicketsToFile();
+        saveTripsToFile();
+        saveWaitlistToFile();
+        printf("%d passenger(s) moved from the waitlist to new seats.\n", promoted);
+    } else {
+        appendTripJournal(&trips[index], mask);
+    }
+    endSharedUpdate(1);
+    return 1;
+}
+
+// Update an existing trip. Changes are collected first, then checked,
+// applied and saved together.
+void updateTrip() {
+    printf("\n========================================\n");
+    printf("           UPDATE TRIP\n");
+    printf("========================================\n");
+    
+    int tripID;
+    printf("Enter Trip ID to update: ");
+    scanf("%d", &tripID);
+    clearInputBuffer();
+    
+    // Find the trip
+    int index = findTripOrInstance(tripID);
+    if (index == -1) {
+        printf("Error: Trip with ID %d not found!\n", tripID);
+        return;
+    }
+
+    // Show warning if any ticket has sold
+    if (trips[index].availableSeats != trips[index].totalSeats) {
+        char confirm;
+        printf("Warning: Some tickets has sold before for this trip.\nThis could cause some confusion.\nDo you still want to change this information: (Y/N) ");
+        scanf("%c", &confirm);
+        if (confirm == 'N' || confirm == 'n') {
+            return;
+        }
+    }
+    
+    // Display current trip information
+    printf("\n--- Current Trip Information ---\n");
+    printf("Trip ID: %d\n", trips[index].tripID);
+    printf("Departure Point: %s\n", trips[index].departurePoint);
+    printf("Arrival Point: %s\n", trips[index].arrivalPoint);
+    printf("Intermediate Stops: %s\n", trips[index].stops[0] ? trips[index].stops : "None");
+    printf("Trip Date: %s\n", trips[index].tripDate);
+    printf("Departure Time: %s\n", trips[index].departureTime);
+    printf("Arrival Time: %s\n", trips[index].arrivalTime[0] ? trips[index].arrivalTime : "Not set");
+    printf("Bus License Plate: %s\n", trips[index].busLicensePlate);
+    printf("Driver Name: %s\n", trips[index].driverName);
+    printf("Total Seats: %d\n", trips[index].totalSeats);
+    printf("Available Seats: %d\n", trips[index].availableSeats);
+    printf("Ticket Price: %.2f TL\n", trips[index].ticketPrice);
+    
+    // Pending changes, FIELD_* bits in mask say which fields of changed are new
+    Trip changed = trips[index];
+    int mask = 0;
+    
+    while (1) {
+    // Update menu
+    int choice = -1;
+    char input[MAX_STRING];
+    int minutes;
+    printf("\n--- What would you like to update? ---\n");
+    printf("1. Departure Point\n");
+    printf("2. Arrival Point\n");
+    printf("3. Trip Date\n");
+    printf("4. Departure Time\n");
+    printf("5. Bus License Plate\n");
+    printf("6. Driver Name\n");
+    printf("7. Total Seats\n");
+    printf("8. Ticket Price\n");
+    printf("9. Intermediate Stops\n");
+    printf("10. Arrival Time\n");
+    printf("11. Discard Changes\n");
+    printf("0. Save Changes and Exit\n");
+    printf("Enter your choice: ");
+    if (scanf("%d", &choice) != 1 && feof(stdin)) {
+        printf("Input error. Changes discarded.\n");
+        return;
+    }
+    clearInputBuffer();
+    
+    switch(choice) {
+        case 1:
+            printf("Enter new Departure Point: ");
+            fgets(changed.departurePoint, MAX_STRING, stdin);
+            changed.departurePoint[strcspn(changed.departurePoint, "\n")] = 0;
+            mask |= FIELD_DEPARTURE_POINT;
+            break;
+            
+        case 2:
+            printf("Enter new Arrival Point: ");
+            fgets(changed.arrivalPoint, MAX_STRING, stdin);
+            changed.arrivalPoint[strcspn(changed.arrivalPoint, "\n")] = 0;
+            mask |= FIELD_ARRIVAL_POINT;
+            break;
+            
+        case 3:
+            printf("Enter new Trip Date (DD/MM/YYYY): ");
+            fgets(input, MAX_STRING, stdin);
+            input[strcspn(input, "\n")] = 0;
+            
+            if (!parseDate(input, &minutes)) {
+                printf("Error: Invalid date! Use DD/MM/YYYY.\n");
+                break;
+            }
+            strcpy(changed.tripDate, input);
+            mask |= FIELD_TRIP_DATE;
+            break;
+            
+        case 4:
+            printf("Enter new Departure Time (HH:MM): ");
+            fgets(input, MAX_STRING, stdin);
+            input[strcspn(input, "\n")] = 0;
+            
+            if (!parseTime(input, &minutes)) {
+                printf("Error: Invalid time! Use HH:MM.\n");
+                break;
+            }
+            strcpy(changed.departureTime, input);
+            mask |= FIELD_DEPARTURE_TIME;
+            break;
+            
+        case 5:
+            printf("Enter new Bus License Plate: ");
+            fgets(changed.busLicensePlate, MAX_STRING, stdin);
+            changed.busLicensePlate[strcspn(changed.busLicensePlate, "\n")] = 0;
+            mask |= FIELD_BUS;
+            break;
+            
+        case 6:
+            printf("Enter new Driver Name: ");
+            fgets(changed.driverName, MAX_STRING, stdin);
+            changed.driverName[strcspn(changed.driverName, "\n")] = 0;
+            mask |= FIELD_DRIVER;
+            break;
+            
+        case 7:
+            printf("Enter new Total Seats: ");
+            int newSeats;
+            scanf("%d", &newSeats);
+            clearInputBuffer();
+            
+            // Sold and held seats are checked when the changes are saved
+            if (newSeats <= 0 || newSeats > MAX_SEATS) {
+                printf("Error: Invalid number of seats!\n");
+                break;
+            }
+            changed.totalSeats = newSeats;
+            mask |= FIELD_SEATS;
+            break;
+            
+        case 8:
+            printf("Enter new Ticket Price: ");
+            float newPrice;
+            scanf("%f", &newPrice);
+            clearInputBuffer();
+            
+            if (newPrice <= 0) {
+                printf("Error: Price must be greater than 0!\n");
+                break;
+            }
+            changed.ticketPrice = newPrice;
+            mask |= FIELD_PRICE;
+            break;
+            
+        case 9:
+            printf("Enter new Intermediate Stops (comma separated, empty for none): ");
+            fgets(input, MAX_STRING, stdin);
+            input[strcspn(input, "\n")] = 0;
+            if (validateStops(input)) {
+                strcpy(changed.stops, input);
+                mask |= FIELD_STOPS;
+            }
+            break;
+            
+        case 10:
+            printf("Enter new Arrival Time (HH:MM): ");
+            fgets(input, MAX_STRING, stdin);
+            input[strcspn(input, "\n")] = 0;
+            
+            if (!parseTime(input, &minutes)) {
+                printf("Error: Invalid time! Use HH:MM.\n");
+                break;
+            }
+            strcpy(changed.arrivalTime, input);
+            mask |= FIELD_ARRIVAL_TIME;
+            break;
+            
+        case 11:
+            printf("Changes discarded.\n");
+            return;
+            
+        case 0:
+            if (mask == 0) {
+                printf("No changes made.\n");
+                return;
+            }
+            if (!commitTripChanges(tripID, &changed, mask)) {
+                printf("No changes were saved. Correct the values above or discard the changes.\n");
+                break;
+            }
+            printf("\n✓ Trip updated successfully!\n");
+            return;
+            
+        default:
+            printf("\n\t[!] Invalid choice!\n");
+            break;
+        }
+    }
+}
+
+// Delete a trip
+void deleteTrip() {
+    printf("\n========================================\n");
+    printf("           DELETE TRIP\n");
+    printf("========================================\n");
+    
+    int tripID;
+    printf("Enter Trip ID to delete: ");
+    scanf("%d", &tripID);
+    clearInputBuffer();
+    
+    // Find the trip
+    int index = findTripOrInstance(tripID);
+    if (index == -1) {
+        printf("Error: Trip with ID %d not found!\n", tripID);
+        return;
+    }
+    
+    // Display trip information
+    printf("\n--- Trip Information ---\n");
+    printf("Trip ID: %d\n", trips[index].tripID);
+    printf("Route: %s -> %s\n", trips[index].departurePoint, trips[index].arrivalPoint);
+    printf("Date: %s at %s\n", trips[index].tripDate, trips[index].departureTime);
+    printf("Driver: %s\n", trips[index].driverName);
+    printf("Available Seats: %d/%d\n", trips[index].availableSeats, trips[index].totalSeats);
+    
+    // Check if there are sold tickets for this trip
+    int soldTickets = trips[index].totalSeats - trips[index].availableSeats;
+    if (soldTickets > 0) {
+        printf("\nWarning: This trip has %d sold ticket(s)!\n", soldTickets);
+        printf("Deleting this trip will also cancel all related tickets.\n");
+    }
+    
+    // Confirmation
+    char confirm;
+    printf("\nAre you sure you want to delete this trip? (Y/N): ");
+    scanf(" %c", &confirm);
+    clearInputBuffer();
+    
+    if (confirm == 'Y' || confirm == 'y') {
+        beginSharedUpdate();
+        index = findTripByID(tripID);
+        if (index == -1) {
+            printf("Error: Trip with ID %d was just deleted at another counter!\n", tripID);
+            endSharedUpdate(0);
+            return;
+        }
+        
+        // Mark trip as inactive (soft delete)
+        trieRemoveName(&driverTrie, trips[index].driverName, index);
+        unscheduleTrip(index);
+        removeConnection(index);
+        trips[index].isActive = 0;
+        
+        // Cancel all tickets for this trip
+        int cancelledCount = 0;
+        for (int i = tripFirstTicket[index]; i != -1; i = ticketNextInTrip[i]) {
+            unindexPassenger(i, &tickets[i]);
+            tickets[i].isActive = 0;
+            cancelledCount++;
+        }
+        tripFirstTicket[index] = -1;
+        tripLastTicket[index] = -1;
+        memset(segmentSeats[index], 0, sizeof(segmentSeats[index]));
+        
+        // Nobody can be promoted onto a deleted trip
+        int dropped = waitlistLength[index];
+        if (dropped > 0) {
+            clearWaitlist(index);
+            saveWaitlistToFile();
+        }
+        
+        // Drop any seat holds on this trip
+        for (int i = 0; i < holdCount; i++) {
+            if (holds[i].isActive && holds[i].tripIndex == index) {
+                releaseHold(i);
+            }
+        }
+        
+        // Save changes
+        saveTripsToFile();
+        saveTicketsToFile();
+        endSharedUpdate(1);
+        
+        printf("\n✓ Trip deleted successfully!\n");
+        if (cancelledCount > 0) {
+            printf("✓ %d ticket(s) have been cancelled.\n", cancelledCount);
+        }
+        if (dropped > 0) {
+            printf("✓ %d waitlist request(s) have been removed.\n", dropped);
+        }
+    } else {
+        printf("\nDeletion cancelled.\n");
+    }
+}
+
+// Inquire trip details
+void inquireTrip() {
+    printf("\n========================================\n");
+    printf("         TRIP INQUIRY\n");
+    printf("========================================\n");
+    
+    int tripID;
+    printf("Enter Trip ID to inquire: ");
+    scanf("%d", &tripID);
+    clearInputBuffer();
+    
+    // Find the trip, falling back to the archive for departed trips
+    int index = findTripOrInstance(tripID);
+    if (index == -1) {
+        if (showArchivedTrip(tripID)) {
+            return;
+        }
+        printf("Error: Trip with ID %d not found!\n", tripID);
+        return;
+    }
+    
+    // Display detailed trip information
+    printf("\n========================================\n");
+    printf("       TRIP DETAILS - ID: %d\n", trips[index].tripID);
+    printf("========================================\n\n");
+    
+    printf("Route Information:\n");
+    printf("  Departure Point : %s\n", trips[index].departurePoint);
+    printf("  Arrival Point   : %s\n", trips[index].arrivalPoint);
+    printf("  Trip Date       : %s\n", trips[index].tripDate);
+    printf("  Departure Time  : %s\n", trips[index].departureTime);
+    if (trips[index].arrivalTime[0]) {
+        printf("  Arrival Time    : %s\n", trips[index].arrivalTime);
+    }
+    
+    // Stops and free seats per segment
+    char stopNames[MAX_STOPS][MAX_STRING];
+    int stopCount = getTripStops(index, stopNames);
+    if (stopCount > 2) {
+        printf("\nSegments:\n");
+        for (int segment = 0; segment < stopCount - 1; segment++) {
+            printf("  %d. %s -> %s : %d seat(s) available\n", segment + 1,
+                   stopNames[segment], stopNames[segment + 1], availableSeatsFor(index, segment, segment + 1));
+        }
+    }
+    
+    printf("\nBus Information:\n");
+    printf("  License Plate   : %s\n", trips[index].busLicensePlate);
+    printf("  Driver Name     : %s\n", trips[index].driverName);
+    
+    printf("\nSeat Information:\n");
+    printf("  Total Seats     : %d\n", trips[index].totalSeats);
+    printf("  Available Seats : %d\n", trips[index].availableSeats);
+    printf("  Sold Seats      : %d\n", trips[index].totalSeats - trips[index].availableSeats);
+    int boardedCount = 0;
+    for (int i = tripFirstTicket[index]; i != -1; i = ticketNextInTrip[i]) {
+        boardedCount += tickets[i].boarded;
+    }
+    if (boardedCount > 0) {
+        printf("  Boarded         : %d\n", boardedCount);
+    }
+    printf("  Occupancy Rate  : %.1f%%\n", 
+           ((float)(trips[index].totalSeats - trips[index].availableSeats) / trips[index].totalSeats) * 100);
+    
+    printf("\nPricing Information:\n");
+    printf("  Ticket Price    : %.2f TL\n", trips[index].ticketPrice);
+    
+    // Show passengers list if there are sold tickets
+    if (tripFirstTicket[index] != -1) {
+        printf("\nPassenger List:\n");
+        printf("  %-5s %-25s %-15s %-15s\n", "Seat", "Passenger Name", "ID Number", "Phone");
+        printf("  %s\n", "------------------------------------------------------------------------");
+        
+        int passengerCount = 0;
+        for (int i = tripFirstTicket[index]; i != -1; i = ticketNextInTrip[i]) {
+            printf("  %-5d %-25s %-15s %-15s\n", 
+                   tickets[i].seatNumber,
+                   tickets[i].passenger.fullName,
+                   tickets[i].passenger.idNumber,
+                   tickets[i].passenger.phoneNumber);
+            if (stopCount > 2) {
+                printf("        %s -> %s\n", stopNames[tickets[i].fromStop], stopNames[tickets[i].toStop]);
+            }
+            passengerCount++;
+        }
+        printf("  %s\n", "------------------------------------------------------------------------");
+        printf("  Total Passengers: %d\n", passengerCount);
+    } else {
+        printf("\n  No tickets sold for this trip yet.\n");
+    }
+    
+    if (waitlistLength[index] > 0) {
+        printf("\nWaitlist: %d passenger(s) waiting\n", waitlistLength[index]);
+    }
+    
+    printf("\n========================================\n");
+}
+
+// List all trips
+void listAllTrips() {
+    printf("\n========================================\n");
+    printf("         ALL TRIPS LIST\n");
+    printf("========================================\n");
+    
+    // Count active trips
+    int activeTrips = 0;
+    for (int i = 0; i < tripCount; i++) {
+        if (trips[i].isActive == 1) {
+            activeTrips++;
+        }
+    }
+    
+    // Check if there are any trips
+    if (activeTrips == 0) {
+        printf("\nNo trips found in the system.\n");
+        return;
+    }
+    
+    printf("\nTotal Active Trips: %d\n\n", activeTrips);
+    
+    // Table header
+    printf("%-6s %-15s %-15s %-12s %-8s %-10s %-5s %-10s\n",
+           "ID", "From", "To", "Date", "Time", "Price", "Seats", "Status");
+    printf("%-6s %-15s %-15s %-12s %-8s %-10s %-5s %-10s\n",
+           "------", "---------------", "---------------", "------------", 
+           "--------", "----------", "-----", "----------");
+    
+    // Display all active trips
+    for (int i = 0; i < tripCount; i++) {
+        if (trips[i].isActive == 1) {
+            // Calculate status
+            char status[20];
+            int soldSeats = trips[i].totalSeats - trips[i].availableSeats;
+            float occupancy = ((float)soldSeats / trips[i].totalSeats) * 100;
+            
+            if (trips[i].availableSeats == 0) {strcpy(status, "FULL");
+            } else if (occupancy >= 80) {strcpy(status, "Almost Full");
+            } else if (occupancy >= 50) {strcpy(status, "Half Full");
+            } else {strcpy(status, "Available");
+            }
+            
+            // Truncate long city names for table format
+            char fromCity[16], toCity[16];
+            strncpy(fromCity, trips[i].departurePoint, 15);
+            fromCity[15] = '\0';
+            strncpy(toCity, trips[i].arrivalPoint, 15);
+            toCity[15] = '\0';
+            
+            printf("%-6d %-15s %-15s %-12s %-8s %-10.2f %d/%-3d %-10s\n",
+                   trips[i].tripID,
+                   fromCity,
+                   toCity,
+                   trips[i].tripDate,
+                   trips[i].departureTime,
+                   trips[i].ticketPrice,
+                   trips[i].availableSeats,
+                   trips[i].totalSeats,
+                   status);
+        }
+    }
+    
+    printf("\n========================================\n");
+    
+    // Summary statistics
+    int totalSeats = 0;
+    int totalAvailable = 0;
+    long long totalRevenue = 0; // In kuruş
+    
+    for (int i = 0; i < tripCount; i++) {
+        if (trips[i].isActive == 1) {
+            totalSeats += trips[i].totalSeats;
+            totalAvailable += trips[i].availableSeats;
+            
+            // Calculate revenue from the prices actually paid
+            for (int t = tripFirstTicket[i]; t != -1; t = ticketNextInTrip[t]) {
+                totalRevenue += priceToKurus(tickets[t].price);
+            }
+        }
+    }
+    
+    char revenueText[32];
+    formatKurus(totalRevenue, revenueText, sizeof(revenueText));
+    
+    printf("\nSummary:\n");
+    printf("  Total Capacity    : %d seats\n", totalSeats);
+    printf("  Available Seats   : %d seats\n", totalAvailable);
+    printf("  Sold Seats        : %d seats\n", totalSeats - totalAvailable);
+    printf("  Overall Occupancy : %.1f%%\n", 
+           totalSeats > 0 ? ((float)(totalSeats - totalAvailable) / totalSeats) * 100 : 0);
+    printf("  Total Revenue     : %s TL\n", revenueText);
+    printf("\n========================================\n");
+}
+
+// Sell a ticket
+void sellTicket() {
+    printf("\n========================================\n");
+    printf("           SELL TICKET\n");
+    printf("========================================\n");
+    
+    // Check if we have space for more tickets
+    if (ticketCount >= MAX_TICKETS) {
+        printf("Error: Maximum ticket limit reached!\n");
+        return;
+    }
+    
+    int tripID;
+    printf("Enter Trip ID: ");
+    scanf("%d", &tripID);
+    clearInputBuffer();
+    
+    // Find the trip
+    int tripIndex = findTripOrInstance(tripID);
+    if (tripIndex == -1) {
+        printf("Error: Trip with ID %d not found!\n", tripID);
+        return;
+    }
+    
+    // Pick the part of the route being travelled
+    int fromStop, toStop;
+    if (!readSegment(tripIndex, &fromStop, &toStop)) {
+        return;
+    }
+    int segmentSeatsLeft = availableSeatsFor(tripIndex, fromStop, toStop);
+    
+    // Check if seats are available, otherwise offer the waitlist
+    if (segmentSeatsLeft <= 0) {
+        printf("Error: No available seats for this trip!\n");
+        joinWaitlist(tripIndex, fromStop, toStop);
+        return;
+    }
+    
+    // Display trip information
+    char stopNames[MAX_STOPS][MAX_STRING];
+    getTripStops(tripIndex, stopNames);
+    printf("\n--- Trip Information ---\n");
+    printf("Route: %s -> %s\n", stopNames[fromStop], stopNames[toStop]);
+    printf("Date: %s at %s\n", trips[tripIndex].tripDate, trips[tripIndex].departureTime);
+    printf("Available Seats: %d/%d\n", segmentSeatsLeft, trips[tripIndex].totalSeats);
+    printf("Price: %.2f TL\n", trips[tripIndex].ticketPrice);
+    
+    // Show occupied seats
+    printf("\nOccupied Seats: ");
+    int hasOccupied = 0;
+    for (int seat = 1; seat <= trips[tripIndex].totalSeats; seat++) {
+        if (isSeatOccupied(tripIndex, seat, fromStop, toStop)) {
+            printf("%d ", seat);
+            hasOccupied = 1;
+        }
+    }
+    if (!hasOccupied) {
+        printf("None (All seats available)");
+    }
+    unsigned long long held = heldSeatMap(tripIndex);
+    if (held != 0) {
+        printf("\nHeld Seats: ");
+        for (int seat = 1; seat <= trips[tripIndex].totalSeats; seat++) {
+            if ((held >> (seat - 1)) & 1) {
+                printf("%d ", seat);
+            }
+        }
+    }
+    printf("\n\n");
+    
+    // Get seat number
+    int seatNumber;
+    int validSeat = 0;
+    while (!validSeat) {
+        printf("Enter Seat Number (1-%d): ", trips[tripIndex].totalSeats);
+        if (scanf("%d", &seatNumber) != 1 && feof(stdin)) {
+            printf("Input error. No ticket was sold.\n");
+            return;
+        }
+        clearInputBuffer();
+        
+        // Validate seat number
+        if (seatNumber < 1 || seatNumber > trips[tripIndex].totalSeats) {
+            printf("Error: Invalid seat number! Please choose between 1 and %d.\n", trips[tripIndex].totalSeats);
+            continue;
+        }
+        
+        // Check if seat is already occupied
+        if (isSeatOccupied(tripIndex, seatNumber, fromStop, toStop)) {
+            printf("Error: Seat %d is already occupied! Please choose another seat.\n", seatNumber);
+            continue;
+        }
+        
+        // A held seat can only be sold to the customer holding it
+        advanceHoldTimers();
+        int holdIndex = findHoldForSeat(tripIndex, seatNumber);
+        if (holdIndex != -1) {
+            int holdID;
+            printf("Seat %d is on hold. Enter Hold ID to complete this purchase (0 to choose another seat): ", seatNumber);
+            scanf("%d", &holdID);
+            clearInputBuffer();
+            
+            if (holdID != holds[holdIndex].holdID) {
+                printf("Error: Seat %d is held for another customer! Please choose another seat.\n", seatNumber);
+                continue;
+            }
+            releaseHold(holdIndex);
+        } else if ((heldSeatMap(tripIndex) >> (seatNumber - 1)) & 1) {
+            printf("Error: Seat %d is on hold at another counter! Please choose another seat.\n", seatNumber);
+            continue;
+        }
+        
+        validSeat = 1;
+    }
+    
+    // Get passenger information
+    printf("\n--- Passenger Information ---\n");
+    Passenger passenger;
+    readPassengerInfo(&passenger);
+    
+    // Another counter may have sold or held the seat meanwhile
+    beginSharedUpdate();
+    if (findTripByID(tripID) != tripIndex || ticketCount >= MAX_TICKETS ||
+        isSeatOccupied(tripIndex, seatNumber, fromStop, toStop) ||
+        ((heldSeatMap(tripIndex) >> (seatNumber - 1)) & 1)) {
+        printf("Error: Seat %d was just taken at another counter! No ticket was sold.\n", seatNumber);
+        endSharedUpdate(0);
+        return;
+    }
+    
+    // Create the ticket and take the seat
+    Ticket newTicket = tickets[issueTicket(tripIndex, seatNumber, fromStop, toStop, &passenger)];
+    
+    // Save to files
+    saveTicketsToFile();
+    saveTripsToFile();
+    endSharedUpdate(1);
+    
+    printf("\n✓ Ticket sold successfully!\n");
+    printf("Ticket ID: %d\n", newTicket.ticketID);
+    printf("Passenger: %s\n", newTicket.passenger.fullName);
+    printf("Seat Number: %d\n", newTicket.seatNumber);
+    printf("Price: %.2f TL\n", newTicket.price);
+    
+    // Ask if user wants to create receipt
+    char createReceiptChoice;
+    printf("\nWould you like to create a receipt? (Y/N): ");
+    scanf(" %c", &createReceiptChoice);
+    clearInputBuffer();
+    
+    if (createReceiptChoice == 'Y' || createReceiptChoice == 'y') {
+        createReceipt(newTicket.ticketID);
+    }
+}
+
+// Read passenger details from the user
+void readPassengerInfo(Passenger *passenger) {
+    printf("Full Name: ");
+    fgets(passenger->fullName, MAX_STRING, stdin);
+    passenger->fullName[strcspn(passenger->fullName, "\n")] = 0;
+    
+    printf("ID Number (TC Kimlik): ");
+    fgets(passenger->idNumber, MAX_STRING, stdin);
+    passenger->idNumber[strcspn(passenger->idNumber, "\n")] = 0;
+    
+    printf("Phone Number: ");
+    fgets(passenger->phoneNumber, MAX_STRING, stdin);
+    passenger->phoneNumber[strcspn(passenger->phoneNumber, "\n")] = 0;
+    
+    printf("Email: ");
+    fgets(passenger->email, MAX_STRING, stdin);
+    passenger->email[strcspn(passenger->email, "\n")] = 0;
+}
+
+// Add a ticket for a seat that is free between two stops and take it
+// (returns the ticket index). The caller checks capacity and seat
+// availability and saves the files.
+int issueTicket(int tripIndex, int seatNumber, int fromStop, int toStop, const Passenger *passenger) {
+    Ticket newTicket;
+    
+    // Generate unique ticket ID
+    newTicket.ticketID = lastTicketID + 1;
+    newTicket.tripID = trips[tripIndex].tripID;
+    newTicket.seatNumber = seatNumber;
+    newTicket.passenger = *passenger;
+    
+    // Set price and date
+    newTicket.price = trips[tripIndex].ticketPrice;
+    getCurrentDateTime(newTicket.purchaseDate, MAX_STRING);
+    newTicket.isActive = 1;
+    newTicket.fromStop = fromStop;
+    newTicket.toStop = toStop;
+    newTicket.boarded = 0;
+    
+    // Add ticket to array
+    tickets[ticketCount] = newTicket;
+    indexTicket(ticketCount);
+    ticketCount++;
+    
+    // Update trip available seats
+    refreshAvailableSeats(tripIndex);
+    
+    return ticketCount - 1;
+}
+
+// Find the lowest-numbered run of free, unheld adjacent seats (returns first seat, -1 if none)
+int findAdjacentSeats(int tripIndex, int count, int fromStop, int toStop) {
+    if (count < 1 || count > trips[tripIndex].totalSeats) {
+        return -1;
+    }
+    
+    // Bit k of runs stays set only if seats k+1 .. k+count are all free
+    unsigned long long freeSeats = freeSeatMap(tripIndex, fromStop, toStop);
+    unsigned long long runs = freeSeats;
+    for (int k = 1; k < count && runs != 0; k++) {
+        runs &= freeSeats >> k;
+    }
+    
+    if (runs == 0) {
+        return -1;
+    }
+    return __builtin_ctzll(runs) + 1;
+}
+
+// Sell tickets for several passengers on one trip, all or nothing
+void sellGroupTickets() {
+    printf("\n========================================\n");
+    printf("        SELL GROUP TICKETS\n");
+    printf("========================================\n");
+    
+    int tripID;
+    printf("Enter Trip ID: ");
+    scanf("%d", &tripID);
+    clearInputBuffer();
+    
+    // Find the trip
+    int tripIndex = findTripOrInstance(tripID);
+    if (tripIndex == -1) {
+        printf("Error: Trip with ID %d not found!\n", tripID);
+        return;
+    }
+    
+    // Pick the part of the route being travelled
+    int fromStop, toStop;
+    if (!readSegment(tripIndex, &fromStop, &toStop)) {
+        return;
+    }
+    
+    // Display trip information
+    char stopNames[MAX_STOPS][MAX_STRING];
+    getTripStops(tripIndex, stopNames);
+    printf("\n--- Trip Information ---\n");
+    printf("Route: %s -> %s\n", stopNames[fromStop], stopNames[toStop]);
+    printf("Date: %s at %s\n", trips[tripIndex].tripDate, trips[tripIndex].departureTime);
+    printf("Available Seats: %d/%d\n", availableSeatsFor(tripIndex, fromStop, toStop), trips[tripIndex].totalSeats);
+    printf("Price: %.2f TL\n", trips[tripIndex].ticketPrice);
+    
+    int groupSize;
+    printf("\nEnter Number of Passengers: ");
+    scanf("%d", &groupSize);
+    clearInputBuffer();
+    
+    // Validate group size against unheld seats and ticket storage
+    int freeSeats = __builtin_popcountll(freeSeatMap(tripIndex, fromStop, toStop));
+    if (groupSize < 1 || groupSize > freeSeats) {
+        printf("Error: Group size must be between 1 and %d!\n", freeSeats);
+        return;
+    }
+    if (ticketCount + groupSize > MAX_TICKETS) {
+        printf("Error: Maximum ticket limit reached!\n");
+        return;
+    }
+    
+    int choice;
+    printf("\n1. Choose Seat Numbers\n");
+    printf("2. Best Adjacent Seats\n");
+    printf("Enter your choice: ");
+    scanf("%d", &choice);
+    clearInputBuffer();
+    
+    // Reserve every seat before asking for passenger details
+    int seats[MAX_SEATS];
+    unsigned long long requested = 0;
+    
+    if (choice == 1) {
+        printf("Enter %d Seat Numbers (1-%d) separated by spaces: ", groupSize, trips[tripIndex].totalSeats);
+        for (int i = 0; i < groupSize; i++) {
+            if (scanf("%d", &seats[i]) != 1) {
+                clearInputBuffer();
+                printf("Error: Expected %d seat numbers!\n", groupSize);
+                return;
+            }
+        }
+        clearInputBuffer();
+        
+        for (int i = 0; i < groupSize; i++) {
+            if (seats[i] < 1 || seats[i] > trips[tripIndex].totalSeats) {
+                printf("Error: Invalid seat number %d! No tickets were sold.\n", seats[i]);
+                return;
+            }
+            
+            unsigned long long bit = 1ULL << (seats[i] - 1);
+            if (requested & bit) {
+                printf("Error: Seat %d is listed twice! No tickets were sold.\n", seats[i]);
+                return;
+            }
+            requested |= bit;
+        }
+        
+        unsigned long long occupied = occupiedSeats(tripIndex, fromStop, toStop);
+        if (requested & occupied) {
+            printf("Error: Seat %d is already occupied! No tickets were sold.\n",
+                   __builtin_ctzll(requested & occupied) + 1);
+            return;
+        }
+        unsigned long long held = heldSeatMap(tripIndex);
+        if (requested & held) {
+            printf("Error: Seat %d is on hold! No tickets were sold.\n",
+                   __builtin_ctzll(requested & held) + 1);
+            return;
+        }
+    } else if (choice == 2) {
+        int firstSeat = findAdjacentSeats(tripIndex, groupSize, fromStop, toStop);
+        if (firstSeat == -1) {
+            printf("Error: No %d adjacent seats are available on this trip!\n", groupSize);
+            return;
+        }
+        
+        for (int i = 0; i < groupSize; i++) {
+            seats[i] = firstSeat + i;
+            requested |= 1ULL << (seats[i] - 1);
+        }
+        printf("Reserved Seats: %d-%d\n", firstSeat, firstSeat + groupSize - 1);
+    } else {
+        printf("\n\t[!] Invalid choice!\n");
+        return;
+    }
+    
+    // Get passenger information for each seat
+    Passenger passengers[MAX_SEATS];
+    for (int i = 0; i < groupSize; i++) {
+        printf("\n--- Passenger %d of %d (Seat %d) ---\n", i + 1, groupSize, seats[i]);
+        readPassengerInfo(&passengers[i]);
+    }
+    
+    // Another counter may have sold or held one of the seats meanwhile
+    beginSharedUpdate();
+    if (findTripByID(tripID) != tripIndex || ticketCount + groupSize > MAX_TICKETS ||
+        (requested & (occupiedSeats(tripIndex, fromStop, toStop) | heldSeatMap(tripIndex)))) {
+        printf("Error: A seat was just taken at another counter! No tickets were sold.\n");
+        endSharedUpdate(0);
+        return;
+    }
+    
+    // Create every ticket, then persist once
+    int firstTicket = ticketCount;
+    for (int i = 0; i < groupSize; i++) {
+        issueTicket(tripIndex, seats[i], fromStop, toStop, &passengers[i]);
+    }
+    
+    saveTicketsToFile();
+    saveTripsToFile();
+    endSharedUpdate(1);
+    
+    printf("\n✓ %d tickets sold successfully!\n", groupSize);
+    printf("  %-10s %-5s %-25s\n", "Ticket ID", "Seat", "Passenger");
+    for (int i = firstTicket; i < ticketCount; i++) {
+        printf("  %-10d %-5d %-25s\n", tickets[i].ticketID, tickets[i].seatNumber, tickets[i].passenger.fullName);
+    }
+    printf("Total Price: %.2f TL\n", trips[tripIndex].ticketPrice * groupSize);
+    
+    // Ask if user wants to create receipts
+    char createReceiptChoice;
+    printf("\nWould you like to create receipts? (Y/N): ");
+    scanf(" %c", &createReceiptChoice);
+    clearInputBuffer();
+    
+    if (createReceiptChoice == 'Y' || createReceiptChoice == 'y') {
+        for (int i = firstTicket; i < ticketCount; i++) {
+            createReceipt(tickets[i].ticketID);
+        }
+    }
+}
+
+// Hold a seat for a limited time while the customer pays
+void holdSeat() {
+    printf("\n========================================\n");
+    printf("            HOLD SEAT\n");
+    printf("========================================\n");
+    
+    // Check if we have space for more holds
+    if (holdCount >= MAX_HOLDS && freeHold == -1) {
+        printf("Error: Maximum hold limit reached!\n");
+        return;
+    }
+    
+    int tripID;
+    printf("Enter Trip ID: ");
+    scanf("%d", &tripID);
+    clearInputBuffer();
+    
+    // Find the trip
+    int tripIndex = findTripOrInstance(tripID);
+    if (tripIndex == -1) {
+        printf("Error: Trip with ID %d not found!\n", tripID);
+        return;
+    }
+    
+    int seatNumber;
+    printf("Enter Seat Number (1-%d): ", trips[tripIndex].totalSeats);
+    scanf("%d", &seatNumber);
+    clearInputBuffer();
+    
+    // Validate seat number and state
+    if (seatNumber < 1 || seatNumber > trips[tripIndex].totalSeats) {
+        printf("Error: Invalid seat number! Please choose between 1 and %d.\n", trips[tripIndex].totalSeats);
+        return;
+    }
+    if (isSeatOccupied(tripIndex, seatNumber, 0, getStopCount(tripIndex) - 1)) {
+        printf("Error: Seat %d is already occupied!\n", seatNumber);
+        return;
+    }
+    if ((heldSeatMap(tripIndex) >> (seatNumber - 1)) & 1) {
+        printf("Error: Seat %d is already on hold!\n", seatNumber);
+        return;
+    }
+    
+    int minutes;
+    printf("Hold Duration in Minutes (1-%d, 0 for %d): ", MAX_HOLD_MINUTES, DEFAULT_HOLD_MINUTES);
+    scanf("%d", &minutes);
+    clearInputBuffer();
+    
+    if (minutes == 0) {
+        minutes = DEFAULT_HOLD_MINUTES;
+    }
+    if (minutes < 0 || minutes > MAX_HOLD_MINUTES) {
+        printf("Error: Hold duration must be between 1 and %d minutes!\n", MAX_HOLD_MINUTES);
+        return;
+    }
+    
+    // Another counter may have sold or held the seat meanwhile
+    beginSharedUpdate();
+    if (findTripByID(tripID) != tripIndex ||
+        isSeatOccupied(tripIndex, seatNumber, 0, getStopCount(tripIndex) - 1) ||
+        ((heldSeatMap(tripIndex) >> (seatNumber - 1)) & 1)) {
+        printf("Error: Seat %d was just taken at another counter!\n", seatNumber);
+        endSharedUpdate(0);
+        return;
+    }
+    
+    // Take a recycled slot or a new one
+    int holdIndex;
+    if (freeHold != -1) {
+        holdIndex = freeHold;
+        freeHold = holds[holdIndex].next;
+    } else {
+        holdIndex = holdCount++;
+    }
+    
+    holds[holdIndex].holdID = ++lastHoldID;
+    holds[holdIndex].tripIndex = tripIndex;
+    holds[holdIndex].seatNumber = seatNumber;
+    holds[holdIndex].expiresAt = currentTime() + (time_t)minutes * 60;
+    holds[holdIndex].isActive = 1;
+    heldMap[tripIndex] |= 1ULL << (seatNumber - 1);
+    publishHeldSeats(tripIndex);
+    scheduleHold(holdIndex);
+    endSharedUpdate(0);
+    
+    char expires[MAX_STRING];
+    struct tm t;
+    localtime_r(&holds[holdIndex].expiresAt, &t);
+    strftime(expires, sizeof(expires), "%H:%M:%S", &t);
+    
+    printf("\n✓ Seat held successfully!\n");
+    printf("Hold ID: %d\n", holds[holdIndex].holdID);
+    printf("Trip ID: %d, Seat Number: %d\n", tripID, seatNumber);
+    printf("Expires at: %s\n", expires);
+    printf("Use Sell Ticket with this Hold ID to complete the purchase.\n");
+}
+
+// Find the active hold on a seat (returns hold index, -1 if the seat is not held)
+int findHoldForSeat(int tripIndex, int seatNumber) {
+    if (!((heldMap[tripIndex] >> (seatNumber - 1)) & 1)) {
+        return -1;
+    }
+    
+    for (int i = 0; i < holdCount; i++) {
+        if (holds[i].isActive && holds[i].tripIndex == tripIndex && holds[i].seatNumber == seatNumber) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Start the timer wheel at the current time
+void initHoldTimers() {
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        for (int slot = 0; slot < WHEEL_SLOTS; slot++) {
+            timerWheel[level][slot] = -1;
+        }
+    }
+    wheelTime = currentTime();
+}
+
+// Put a hold into the wheel slot matching its expiry
+void scheduleHold(int holdIndex) {
+    time_t expiresAt = holds[holdIndex].expiresAt;
+    time_t delta = expiresAt - wheelTime;
+    int level = 0;
+    
+    // Pick the finest level whose range still covers the expiry
+    while (level < WHEEL_LEVELS - 1 && delta >= ((time_t)1 << (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    if (delta < 0) {
+        expiresAt = wheelTime + 1; // Overdue, expire on the next tick
+    }
+    
+    int slot = (int)((expiresAt >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+    holds[holdIndex].wheelLevel = level;
+    holds[holdIndex].wheelSlot = slot;
+    holds[holdIndex].prev = -1;
+    holds[holdIndex].next = timerWheel[level][slot];
+    if (timerWheel[level][slot] != -1) {
+        holds[timerWheel[level][slot]].prev = holdIndex;
+    }
+    timerWheel[level][slot] = holdIndex;
+}
+
+// Unlink a hold from its wheel slot, free its seat and recycle the slot
+void releaseHold(int holdIndex) {
+    SeatHold *hold = &holds[holdIndex];
+    
+    if (hold->prev != -1) {
+        holds[hold->prev].next = hold->next;
+    } else {
+        timerWheel[hold->wheelLevel][hold->wheelSlot] = hold->next;
+    }
+    if (hold->next != -1) {
+        holds[hold->next].prev = hold->prev;
+    }
+    
+    heldMap[hold->tripIndex] &= ~(1ULL << (hold->seatNumber - 1));
+    publishHeldSeats(hold->tripIndex);
+    hold->isActive = 0;
+    hold->next = freeHold;
+    freeHold = holdIndex;
+}
+
+// Advance the wheel to now, one second per tick, releasing expired holds
+void advanceHoldTimers() {
+    time_t now = currentTime();
+    
+    while (wheelTime < now) {
+        wheelTime++;
+        
+        // Cascade coarser slots down when a finer level wraps around
+        for (int level = 1; level < WHEEL_LEVELS; level++) {
+            if ((wheelTime & (((time_t)1 << (WHEEL_BITS * level)) - 1)) != 0) {
+                break;
+            }
+            
+            int slot = (int)((wheelTime >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+            int holdIndex = timerWheel[level][slot];
+            timerWheel[level][slot] = -1;
+            while (holdIndex != -1) {
+                int next = holds[holdIndex].next;
+                scheduleHold(holdIndex);
+                holdIndex = next;
+            }
+        }
+        
+        // Everything in the current finest slot expires now
+        int slot = (int)(wheelTime & (WHEEL_SLOTS - 1));
+        while (timerWheel[0][slot] != -1) {
+            releaseHold(timerWheel[0][slot]);
+        }
+    }
+}
+
+// Offer a place on the waitlist of a full trip
+void joinWaitlist(int tripIndex, int fromStop, int toStop) {
+    char confirm;
+    printf("\nWould you like to join the waitlist for this trip? (Y/N): ");
+    scanf(" %c", &confirm);
+    clearInputBuffer();
+    
+    if (confirm != 'Y' && confirm != 'y') {
+        return;
+    }
+    
+    // Check if we have space for more waitlist entries
+    if (waitlistCount >= MAX_WAITLIST && freeWaitlist == -1) {
+        printf("Error: Maximum waitlist limit reached!\n");
+        return;
+    }
+    
+    printf("\n--- Passenger Information ---\n");
+    Passenger passenger;
+    readPassengerInfo(&passenger);
+    
+    if (!enqueueWaitlist(tripIndex, fromStop, toStop, &passenger)) {
+        printf("Error: Could not add passenger to the waitlist!\n");
+        return;
+    }
+    saveWaitlistToFile();
+    
+    printf("\n✓ Added to the waitlist!\n");
+    printf("Passenger: %s\n", passenger.fullName);
+    printf("Position: %d\n", waitlistLength[tripIndex]);
+    printf("A ticket will be issued automatically when a seat is released.\n");
+}
+
+// Append a passenger to a trip's waitlist (returns 0 if it is full)
+int enqueueWaitlist(int tripIndex, int fromStop, int toStop, const Passenger *passenger) {
+    int entry;
+    if (freeWaitlist != -1) {
+        entry = freeWaitlist;
+        freeWaitlist = waitlist[entry].next;
+    } else if (waitlistCount < MAX_WAITLIST) {
+        entry = waitlistCount++;
+    } else {
+        return 0;
+    }
+    
+    // Pack the four strings back to back
+    size_t nameLength = strlen(passenger->fullName) + 1;
+    size_t idLength = strlen(passenger->idNumber) + 1;
+    size_t phoneLength = strlen(passenger->phoneNumber) + 1;
+    size_t emailLength = strlen(passenger->email) + 1;
+    char *details = malloc(nameLength + idLength + phoneLength + emailLength);
+    if (details == NULL) {
+        waitlist[entry].next = freeWaitlist;
+        freeWaitlist = entry;
+        return 0;
+    }
+    memcpy(details, passenger->fullName, nameLength);
+    memcpy(details + nameLength, passenger->idNumber, idLength);
+    memcpy(details + nameLength + idLength, passenger->phoneNumber, phoneLength);
+    memcpy(details + nameLength + idLength + phoneLength, passenger->email, emailLength);
+    
+    waitlist[entry].tripID = trips[tripIndex].tripID;
+    waitlist[entry].fromStop = fromStop;
+    waitlist[entry].toStop = toStop;
+    waitlist[entry].details = details;
+    waitlist[entry].next = -1;
+    
+    if (waitlistTail[tripIndex] == -1) {
+        waitlistHead[tripIndex] = entry;
+    } else {
+        waitlist[waitlistTail[tripIndex]].next = entry;
+    }
+    waitlistTail[tripIndex] = entry;
+    waitlistLength[tripIndex]++;
+    return 1;
+}
+
+// Remove the first passenger from a trip's waitlist (returns 0 if it is empty)
+int dequeueWaitlist(int tripIndex, Passenger *passenger, int *fromStop, int *toStop) {
+    int entry = waitlistHead[tripIndex];
+    if (entry == -1) {
+        return 0;
+    }
+    *fromStop = waitlist[entry].fromStop;
+    *toStop = waitlist[entry].toStop;
+    
+    // Unpack the details
+    const char *p = waitlist[entry].details;
+    strcpy(passenger->fullName, p);
+    p += strlen(p) + 1;
+    strcpy(passenger->idNumber, p);
+    p += strlen(p) + 1;
+    strcpy(passenger->phoneNumber, p);
+    p += strlen(p) + 1;
+    strcpy(passenger->email, p);
+    
+    waitlistHead[tripIndex] = waitlist[entry].next;
+    if (waitlistHead[tripIndex] == -1) {
+        waitlistTail[tripIndex] = -1;
+    }
+    waitlistLength[tripIndex]--;
+    
+    free(waitlist[entry].details);
+    waitlist[entry].details = NULL;
+    waitlist[entry].next = freeWaitlist;
+    freeWaitlist = entry;
+    return 1;
+}
+
+// Drop every passenger waiting for a trip
+void clearWaitlist(int tripIndex) {
+    Passenger passenger;
+    int fromStop, toStop;
+    while (dequeueWaitlist(tripIndex, &passenger, &fromStop, &toStop)) {
+    }
+}
+
+// Issue tickets to waiting passengers while free seats remain (returns tickets issued).
+// The caller saves the files, just like after a normal sale.
+int promoteFromWaitlist(int tripIndex) {
+    int promoted = 0;
+    
+    // Strict FIFO: stop at the first passenger whose segment has no free seat
+    while (waitlistHead[tripIndex] != -1 && ticketCount < MAX_TICKETS) {
+        WaitlistEntry *head = &waitlist[waitlistHead[tripIndex]];
+        unsigned long long freeSeats = freeSeatMap(tripIndex, head->fromStop, head->toStop);
+        if (freeSeats == 0) {
+            break;
+        }
+        
+        Passenger passenger;
+        int fromStop, toStop;
+        dequeueWaitlist(tripIndex, &passenger, &fromStop, &toStop);
+        int ticketIndex = issueTicket(tripIndex, __builtin_ctzll(freeSeats) + 1, fromStop, toStop, &passenger);
+        
+        printf("✓ Waitlisted passenger %s received Ticket ID %d (Seat %d).\n",
+               passenger.fullName, tickets[ticketIndex].ticketID, tickets[ticketIndex].seatNumber);
+        promoted++;
+    }
+    
+    return promoted;
+}
+
+// Save all waitlists to file
+void saveWaitlistToFile() {
+    requestSave(SAVE_WAITLIST);
+}
+
+// Write this counter's waitlists, each trip's queue in order
+void writeWaitlistFile() {
+    char tempName[sizeof(waitlistFile) + 4];
+    FILE *file = openDataFile(waitlistFile, tempName, sizeof(tempName));
+    if (file == NULL) {
+        printf("Error: Could not open waitlist file for writing!\n");
+        return;
+    }
+    
+    // Write entry count
+    int total = 0;
+    for (int i = 0; i < tripCount; i++) {
+        total += waitlistLength[i];
+    }
+    fprintf(file, "%d\n", total);
+    
+    // Write all entries
+    for (int i = 0; i < tripCount; i++) {
+        for (int entry = waitlistHead[i]; entry != -1; entry = waitlist[entry].next) {
+            const char *name = waitlist[entry].details;
+            const char *idNumber = name + strlen(name) + 1;
+            const char *phone = idNumber + strlen(idNumber) + 1;
+            const char *email = phone + strlen(phone) + 1;
+            fprintf(file, "%d|%s|%s|%s|%s|%d|%d\n", waitlist[entry].tripID, name, idNumber, phone, email,
+                    waitlist[entry].fromStop, waitlist[entry].toStop);
+        }
+    }
+    
+    closeDataFile(file, tempName, waitlistFile);
+}
+
+// Parse one waitlist line (returns a RECORD_* result)
+int parseWaitlistRecord(const Field *fields, int fieldCount, void *record) {
+    WaitlistRecord *waiting = (WaitlistRecord *)record;
+    if (fieldCount != 5 && fieldCount != 7) { // Files without segments have 5 fields
+        return RECORD_BAD_FIELD_COUNT;
+    }
+    
+    waiting->fromStop = 0;
+    waiting->toStop = -1;
+    if (!parseIntField(&fields[0], &waiting->tripID) ||
+        (fieldCount == 7 &&
+         (!parseIntField(&fields[5], &waiting->fromStop) || !parseIntField(&fields[6], &waiting->toStop)))) {
+        return RECORD_BAD_NUMBER;
+    }
+    
+    int truncated = 0;
+    truncated |= copyTextField(waiting->passenger.fullName, &fields[1]);
+    truncated |= copyTextField(waiting->passenger.idNumber, &fields[2]);
+    truncated |= copyTextField(waiting->passenger.phoneNumber, &fields[3]);
+    truncated |= copyTextField(waiting->passenger.email, &fields[4]);
+    return truncated ? RECORD_TRUNCATED : RECORD_OK;
+}
+
+// Load all waitlists from file (call after the trip index is built)
+void loadWaitlistFromFile() {
+    WaitlistRecord *records = malloc(sizeof(WaitlistRecord) * MAX_WAITLIST);
+    if (records == NULL) {
+        printf("Error: Not enough memory to load the waitlist!\n");
+        return;
+    }
+    
+    int loaded = loadRecordsFromFile(waitlistFile, records, sizeof(WaitlistRecord), MAX_WAITLIST, parseWaitlistRecord);
+    int queued = 0;
+    for (int i = 0; i < loaded; i++) {
+        int tripIndex = findTripByID(records[i].tripID);
+        if (tripIndex == -1) {
+            continue;
+        }
+        
+        // Requests without a valid segment cover the whole route
+        int lastStop = getStopCount(tripIndex) - 1;
+        if (records[i].fromStop < 0 || records[i].toStop > lastStop || records[i].fromStop >= records[i].toStop) {
+            records[i].fromStop = 0;
+            records[i].toStop = lastStop;
+        }
+        if (enqueueWaitlist(tripIndex, records[i].fromStop, records[i].toStop, &records[i].passenger)) {
+            queued++;
+        }
+    }
+    
+    free(records);
+    if (loaded > 0) {
+        printf("Loaded %d waitlist entries from file.\n", queued);
+    }
+}
+
+// Find a passenger's active tickets by ID number or phone
+void findPassengerTickets() {
+    printf("\n========================================\n");
+    printf("         FIND MY TICKETS\n");
+    printf("========================================\n");
+    
+    char query[MAX_STRING];
+    printf("Enter ID Number (TC Kimlik) or Phone Number: ");
+    fgets(query, MAX_STRING, stdin);
+    query[strcspn(query, "\n")] = 0;
+    
+    if (query[0] == '\0') {
+        printf("Error: Please enter an ID or phone number!\n");
+        return;
+    }
+    
+    // Collect matches from both indexes
+    int matches[MAX_TICKETS];
+    int matchCount = 0;
+    
+    for (int i = idNumberHashHead[hashString(query, PASSENGER_HASH_SIZE)]; i != -1; i = idNumberHashNext[i]) {
+        if (strcmp(tickets[i].passenger.idNumber, query) == 0) {
+            matches[matchCount++] = i;
+        }
+    }
+    
+    // An ID number is never looked up as a phone, so one passenger's ID
+    // cannot bring up another passenger's tickets by a similar phone
+    char phoneKey[MAX_STRING];
+    char ticketPhoneKey[MAX_STRING];
+    makePhoneKey(query, phoneKey);
+    if (phoneKey[0] != '\0' && !isIdNumber(query)) {
+        for (int i = phoneHashHead[hashString(phoneKey, PASSENGER_HASH_SIZE)]; i != -1; i = phoneHashNext[i]) {
+            makePhoneKey(tickets[i].passenger.phoneNumber, ticketPhoneKey);
+            if (strcmp(ticketPhoneKey, phoneKey) == 0 && strcmp(tickets[i].passenger.idNumber, query) != 0) {
+                matches[matchCount++] = i;
+            }
+        }
+    }
+    
+    if (matchCount == 0) {
+        printf("\nNo active tickets found for %s.\n", query);
+        return;
+    }
+    
+    printf("\n%-8s %-6s %-15s %-15s %-12s %-8s %-5s %-20s\n",
+           "Ticket", "Trip", "From", "To", "Date", "Time", "Seat", "Passenger");
+    printf("%-8s %-6s %-15s %-15s %-12s %-8s %-5s %-20s\n",
+           "--------", "------", "---------------", "---------------", "------------",
+           "--------", "-----", "--------------------");
+    
+    int shown = 0;
+    for (int m = matchCount - 1; m >= 0; m--) {
+        Ticket *ticket = &tickets[matches[m]];
+        int tripIndex = findTripByID(ticket->tripID);
+        if (tripIndex == -1) {
+            continue;
+        }
+        shown++;
+        
+        // Truncate long city names for table format
+        char fromCity[16], toCity[16];
+        strncpy(fromCity, trips[tripIndex].departurePoint, 15);
+        fromCity[15] = '\0';
+        strncpy(toCity, trips[tripIndex].arrivalPoint, 15);
+        toCity[15] = '\0';
+        
+        printf("%-8d %-6d %-15s %-15s %-12s %-8s %-5d %-20s\n",
+               ticket->ticketID,
+               ticket->tripID,
+               fromCity,
+               toCity,
+               trips[tripIndex].tripDate,
+               trips[tripIndex].departureTime,
+               ticket->seatNumber,
+               ticket->passenger.fullName);
+    }
+    
+    printf("\nTotal Tickets: %d\n", shown);
+}
+
+// Type-ahead search on passenger or driver names
+void searchByName() {
+    printf("\n========================================\n");
+    printf("          SEARCH BY NAME\n");
+    printf("========================================\n");
+    
+    int choice;
+    printf("1. Passenger Name\n");
+    printf("2. Driver Name\n");
+    printf("Enter your choice: ");
+    scanf("%d", &choice);
+    clearInputBuffer();
+    
+    if (choice != 1 && choice != 2) {
+        printf("\n\t[!] Invalid choice!\n");
+        return;
+    }
+    NameTrie *trie = choice == 1 ? &passengerTrie : &driverTrie;
+    
+    char typed[MAX_STRING] = "";
+    char more[MAX_STRING];
+    char folded[MAX_FOLDED];
+    TrieCursor cursor;
+    trieCursorStart(&cursor);
+    
+    printf("Enter the beginning of a name: ");
+    while (fgets(more, MAX_STRING, stdin) != NULL) {
+        more[strcspn(more, "\n")] = 0;
+        if (more[0] == '\0') {
+            break;
+        }
+        
+        // Extend the query and continue the walk from the previous position
+        strncat(typed, more, MAX_STRING - strlen(typed) - 1);
+        foldName(typed, folded, sizeof(folded));
+        trieCursorAdvance(trie, &cursor, folded);
+        
+        int values[NAME_SEARCH_LIMIT + 1];
+        int found = trieCollect(trie, &cursor, values, NAME_SEARCH_LIMIT + 1);
+        int shown = found > NAME_SEARCH_LIMIT ? NAME_SEARCH_LIMIT : found;
+        
+        printf("\nMatches for \"%s\":\n", typed);
+        if (found == 0) {
+            printf("  None\n");
+        } else if (choice == 1) {
+            printf("  %-8s %-6s %-5s %-25s %-12s\n", "Ticket", "Trip", "Seat", "Passenger", "Date");
+            for (int i = 0; i < shown; i++) {
+                Ticket *ticket = &tickets[values[i]];
+                int tripIndex = findTripByID(ticket->tripID);
+                printf("  %-8d %-6d %-5d %-25s %-12s\n", ticket->ticketID, ticket->tripID, ticket->seatNumber,
+                       ticket->passenger.fullName, tripIndex != -1 ? trips[tripIndex].tripDate : "-");
+            }
+        } else {
+            printf("  %-6s %-20s %-15s %-15s %-12s %-8s\n", "Trip", "Driver", "From", "To", "Date", "Time");
+            for (int i = 0; i < shown; i++) {
+                Trip *trip = &trips[values[i]];
+                
+                // Truncate long city names for table format
+                char fromCity[16], toCity[16];
+                strncpy(fromCity, trip->departurePoint, 15);
+                fromCity[15] = '\0';
+                strncpy(toCity, trip->arrivalPoint, 15);
+                toCity[15] = '\0';
+                
+                printf("  %-6d %-20s %-15s %-15s %-12s %-8s\n", trip->tripID, trip->driverName,
+                       fromCity, toCity, trip->tripDate, trip->departureTime);
+            }
+        }
+        if (found > NAME_SEARCH_LIMIT) {
+            printf("  ... more matches, type more letters to narrow down\n");
+        }
+        
+        printf("\nType more letters to refine (Enter to finish): %s", typed);
+    }
+}
+
+// Convert "DD/MM/YYYY" to days since 01/01/1970 (returns 0 if malformed)
+int parseDate(const char *date, int *days) {
+    int day, month, year;
+    char extra;
+    if (sscanf(date, "%d/%d/%d%c", &day, &month, &year, &extra) != 3 ||
+        month < 1 || month > 12 || day < 1 || day > 31 || year < 1970 || year > 9999) {
+        return 0;
+    }
+    
+    // Days from civil date (proleptic Gregorian calendar)
+    int y = month <= 2 ? year - 1 : year;
+    int era = y / 400;
+    int yearOfEra = y - era * 400;
+    int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    *days = era * 146097 + dayOfEra - 719468;
+    return 1;
+}
+
+// Convert a price to whole kuruş, rounding to the nearest one
+long long priceToKurus(float price) {
+    double kurus = (double)price * 100.0;
+    return (long long)(kurus < 0 ? kurus - 0.5 : kurus + 0.5);
+}
+
+// Format kuruş as "1234.50"
+void formatKurus(long long kurus, char *buffer, size_t size) {
+    const char *sign = kurus < 0 ? "-" : "";
+    if (kurus < 0) {
+        kurus = -kurus;
+    }
+    snprintf(buffer, size, "%s%lld.%02lld", sign, kurus / 100, kurus % 100);
+}
+
+// Release the columns of a view
+void freeAnalyticsView(AnalyticsView *view) {
+    free(view->tripSource);
+    free(view->tripSeats);
+    free(view->tripSeatSegments);
+    free(view->tripGroup);
+    free(view->ticketTrip);
+    free(view->ticketSegments);
+    free(view->ticketKurus);
+    memset(view, 0, sizeof(*view));
+}
+
+// Copy active trips and tickets into contiguous columns (returns 0 if out of memory)
+int buildAnalyticsView(AnalyticsView *view) {
+    memset(view, 0, sizeof(*view));
+    int rows = tripCount > 0 ? tripCount : 1;
+    int ticketRows = ticketCount > 0 ? ticketCount : 1;
+    
+    view->tripSource = malloc(sizeof(int) * rows);
+    view->tripSeats = malloc(sizeof(int) * rows);
+    view->tripSeatSegments = malloc(sizeof(int) * rows);
+    view->tripGroup = malloc(sizeof(int) * rows);
+    view->ticketTrip = malloc(sizeof(int) * ticketRows);
+    view->ticketSegments = malloc(sizeof(int) * ticketRows);
+    view->ticketKurus = malloc(sizeof(long long) * ticketRows);
+    if (!view->tripSource || !view->tripSeats || !view->tripSeatSegments || !view->tripGroup ||
+        !view->ticketTrip || !view->ticketSegments || !view->ticketKurus) {
+        freeAnalyticsView(view);
+        return 0;
+    }
+    
+    // Trip rows, with each trip's active tickets right after it is added
+    for (int i = 0; i < tripCount; i++) {
+        if (trips[i].isActive != 1) {
+            continue;
+        }
+        
+        int row = view->tripCount++;
+        view->tripSource[row] = i;
+        view->tripSeats[row] = trips[i].totalSeats;
+        view->tripSeatSegments[row] = trips[i].totalSeats * (getStopCount(i) - 1);
+        
+        for (int t = tripFirstTicket[i]; t != -1; t = ticketNextInTrip[t]) {
+            view->ticketTrip[view->ticketCount] = row;
+            view->ticketSegments[view->ticketCount] = tickets[t].toStop - tickets[t].fromStop;
+            view->ticketKurus[view->ticketCount] = priceToKurus(tickets[t].price);
+            view->ticketCount++;
+        }
+    }
+    
+    return 1;
+}
+
+// Assign every trip row to a group and name the groups (returns the group count)
+int groupAnalyticsView(AnalyticsView *view, int groupBy, char (*names)[GROUP_NAME_LENGTH]) {
+    static const char *weekdays[] = {"Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"};
+    int groupCount = 0;
+    
+    // Open addressing table from group name hash to group number
+    unsigned int tableSize = 1;
+    while (tableSize < (unsigned int)view->tripCount * 2 + 16) {
+        tableSize <<= 1;
+    }
+    int *table = malloc(sizeof(int) * tableSize);
+    if (table == NULL) {
+        return 0;
+    }
+    for (unsigned int i = 0; i < tableSize; i++) {
+        table[i] = -1;
+    }
+    
+    for (int row = 0; row < view->tripCount; row++) {
+        Trip *trip = &trips[view->tripSource[row]];
+        char key[GROUP_NAME_LENGTH];
+        int days;
+        
+        switch (groupBy) {
+            case GROUP_BY_ROUTE:
+                snprintf(key, sizeof(key), "%s -> %s", trip->departurePoint, trip->arrivalPoint);
+                break;
+            case GROUP_BY_DATE:
+                snprintf(key, sizeof(key), "%s", trip->tripDate);
+                break;
+            case GROUP_BY_WEEKDAY:
+                // 01/01/1970 was a Thursday
+                snprintf(key, sizeof(key), "%s", parseDate(trip->tripDate, &days) ? weekdays[(days + 4) % 7] : "Unknown");
+                break;
+            default:
+                snprintf(key, sizeof(key), "%s", trip->driverName);
+                break;
+        }
+        
+        // Find or add the group
+        unsigned int slot = hashString(key, tableSize);
+        while (table[slot] != -1 && strcmp(names[table[slot]], key) != 0) {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if (table[slot] == -1) {
+            strcpy(names[groupCount], key);
+            table[slot] = groupCount++;
+        }
+        view->tripGroup[row] = table[slot];
+    }
+    
+    free(table);
+    return groupCount;
+}
+
+// Revenue and load factor reports
+void showReports() {
+    printf("\n========================================\n");
+    printf("     REVENUE & OCCUPANCY REPORTS\n");
+    printf("========================================\n");
+    
+    int groupBy;
+    printf("1. By Route\n");
+    printf("2. By Date\n");
+    printf("3. By Weekday\n");
+    printf("4. By Driver\n");
+    printf("Enter your choice: ");
+    scanf("%d", &groupBy);
+    clearInputBuffer();
+    
+    if (groupBy < GROUP_BY_ROUTE || groupBy > GROUP_BY_DRIVER) {
+        printf("\n\t[!] Invalid choice!\n");
+        return;
+    }
+    
+    struct timespec started, finished;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    
+    AnalyticsView view;
+    if (!buildAnalyticsView(&view)) {
+        printf("Error: Not enough memory to build the report!\n");
+        return;
+    }
+    if (view.tripCount == 0) {
+        printf("\nNo trips found in the system.\n");
+        freeAnalyticsView(&view);
+        return;
+    }
+    
+    int rows = view.tripCount;
+    char (*names)[GROUP_NAME_LENGTH] = malloc(sizeof(*names) * rows);
+    long long *revenue = calloc(rows, sizeof(long long));
+    int *sold = calloc(rows, sizeof(int));
+    int *capacity = calloc(rows, sizeof(int));
+    int *tripsInGroup = calloc(rows, sizeof(int));
+    long long *seatSegments = calloc(rows, sizeof(long long));
+    long long *soldSegments = calloc(rows, sizeof(long long));
+    int *ticketGroup = malloc(sizeof(int) * (view.ticketCount > 0 ? view.ticketCount : 1));
+    int *order = malloc(sizeof(int) * rows);
+    if (!names || !revenue || !sold || !capacity || !tripsInGroup || !seatSegments || !soldSegments ||
+        !ticketGroup || !order) {
+        printf("Error: Not enough memory to build the report!\n");
+        free(names); free(revenue); free(sold); free(capacity); free(tripsInGroup);
+        free(seatSegments); free(soldSegments); free(ticketGroup); free(order);
+        freeAnalyticsView(&view);
+        return;
+    }
+    
+    int groupCount = groupAnalyticsView(&view, groupBy, names);
+    
+    // Straight passes over the columns; each loop touches one or two arrays
+    for (int row = 0; row < view.tripCount; row++) {
+        capacity[view.tripGroup[row]] += view.tripSeats[row];
+        seatSegments[view.tripGroup[row]] += view.tripSeatSegments[row];
+        tripsInGroup[view.tripGroup[row]]++;
+    }
+    for (int i = 0; i < view.ticketCount; i++) {
+        ticketGroup[i] = view.tripGroup[view.ticketTrip[i]];
+    }
+    for (int i = 0; i < view.ticketCount; i++) {
+        revenue[ticketGroup[i]] += view.ticketKurus[i];
+        soldSegments[ticketGroup[i]] += view.ticketSegments[i];
+        sold[ticketGroup[i]]++;
+    }
+    
+    // Highest revenue first
+    for (int g = 0; g < groupCount; g++) {
+        order[g] = g;
+    }
+    for (int i = 1; i < groupCount; i++) {
+        int g = order[i];
+        int j = i - 1;
+        while (j >= 0 && revenue[order[j]] < revenue[g]) {
+            order[j + 1] = order[j];
+            j--;
+        }
+        order[j + 1] = g;
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+    double elapsedMs = (finished.tv_sec - started.tv_sec) * 1000.0 + (finished.tv_nsec - started.tv_nsec) / 1e6;
+    
+    // Print the table
+    printf("\n%-32s %-6s %-9s %-6s %-7s %-14s\n", "Group", "Trips", "Capacity", "Sold", "Load", "Revenue (TL)");
+    printf("%-32s %-6s %-9s %-6s %-7s %-14s\n", "--------------------------------", "------",
+           "---------", "------", "-------", "--------------");
+    
+    // Load factor counts seat-segments, so a seat resold after an
+    // intermediate stop never pushes a trip past 100%
+    long long totalRevenue = 0;
+    long long totalSeatSegments = 0;
+    long long totalSoldSegments = 0;
+    int totalSold = 0;
+    int totalCapacity = 0;
+    for (int i = 0; i < groupCount; i++) {
+        int g = order[i];
+        char label[33];
+        char money[32];
+        strncpy(label, names[g], 32);
+        label[32] = '\0';
+        formatKurus(revenue[g], money, sizeof(money));
+        
+        printf("%-32s %-6d %-9d %-6d %5.1f%%  %14s\n", label, tripsInGroup[g], capacity[g], sold[g],
+               seatSegments[g] > 0 ? (double)soldSegments[g] * 100.0 / seatSegments[g] : 0.0, money);
+        
+        totalRevenue += revenue[g];
+        totalSeatSegments += seatSegments[g];
+        totalSoldSegments += soldSegments[g];
+        totalSold += sold[g];
+        totalCapacity += capacity[g];
+    }
+    
+    char money[32];
+    formatKurus(totalRevenue, money, sizeof(money));
+    printf("%-32s %-6d %-9d %-6d %5.1f%%  %14s\n", "TOTAL", view.tripCount, totalCapacity, totalSold,
+           totalSeatSegments > 0 ? (double)totalSoldSegments * 100.0 / totalSeatSegments : 0.0, money);
+    printf("\nComputed over %d trips and %d tickets in %.3f ms.\n", view.tripCount, view.ticketCount, elapsedMs);
+    
+    free(names); free(revenue); free(sold); free(capacity); free(tripsInGroup);
+    free(seatSegments); free(soldSegments); free(ticketGroup); free(order);
+    freeAnalyticsView(&view);
+}
+
+// Parse a HH:MM time into minutes after midnight (returns 0 if malformed)
+int parseTime(const char *time, int *minutes) {
+    int hour, minute;
+    char extra;
+    if (sscanf(time, "%d:%d%c", &hour, &minute, &extra) != 2 ||
+        hour < 0 || hour > 23 || minute < 0 || minute > 59) {
+        return 0;
+    }
+    *minutes = hour * 60 + minute;
+    return 1;
+}
+
+// Minutes from departure to arrival of a trip (returns 0 if its date or
+// departure time cannot be read). An arrival not after the departure is
+// on the next day.
+int getTripWindow(const Trip *trip, int *start, int *end) {
+    int day, departure, arrival;
+    if (!parseDate(trip->tripDate, &day) || !parseTime(trip->departureTime, &departure)) {
+        return 0;
+    }
+    
+    *start = day * MINUTES_PER_DAY + departure;
+    if (!parseTime(trip->arrivalTime, &arrival)) {
+        *end = *start + DEFAULT_TRIP_MINUTES;
+    } else {
+        *end = day * MINUTES_PER_DAY + arrival + (arrival <= departure ? MINUTES_PER_DAY : 0);
+    }
+    return 1;
+}
+
+// Plates match ignoring case, spaces and dashes ("06 AB 123" = "06ab-123")
+void makeBusKey(const char *plate, char *key, size_t size) {
+    size_t length = 0;
+    for (const char *p = plate; *p && length + 1 < size; p++) {
+        if ((*p >= '0' && *p <= '9') || (*p >= 'A' && *p <= 'Z')) {
+            key[length++] = *p;
+        } else if (*p >= 'a' && *p <= 'z') {
+            key[length++] = (char)(*p - ('a' - 'A'));
+        }
+    }
+    key[length] = '\0';
+}
+
+// Empty a schedule index
+void scheduleReset(ScheduleIndex *index) {
+    for (int i = 0; i < SCHEDULE_HASH_SIZE; i++) index->hashHead[i] = -1;
+    for (int i = 0; i < MAX_TRIPS; i++) index->treeOf[i] = -1;
+    index->treeCount = 0;
+    index->freeTree = -1;
+}
+
+// Find the tree of a bus or driver key (returns -1 if it has no trips)
+int scheduleFindTree(const ScheduleIndex *index, const char *key) {
+    for (int i = index->hashHead[hashString(key, SCHEDULE_HASH_SIZE)]; i != -1; i = index->trees[i].next) {
+        if (strcmp(index->trees[i].key, key) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Recompute a node's subtree maximum end
+void intervalUpdate(IntervalNode *nodes, int node) {
+    int maxEnd = nodes[node].end;
+    if (nodes[node].left != -1 && nodes[nodes[node].left].maxEnd > maxEnd) {
+        maxEnd = nodes[nodes[node].left].maxEnd;
+    }
+    if (nodes[node].right != -1 && nodes[nodes[node].right].maxEnd > maxEnd) {
+        maxEnd = nodes[nodes[node].right].maxEnd;
+    }
+    nodes[node].maxEnd = maxEnd;
+}
+
+// Join two treaps where every node of left comes before every node of right
+int intervalMerge(IntervalNode *nodes, int left, int right) {
+    if (left == -1) return right;
+    if (right == -1) return left;
+    
+    if (nodes[left].priority > nodes[right].priority) {
+        nodes[left].right = intervalMerge(nodes, nodes[left].right, right);
+        intervalUpdate(nodes, left);
+        return left;
+    }
+    nodes[right].left = intervalMerge(nodes, left, nodes[right].left);
+    intervalUpdate(nodes, right);
+    return right;
+}
+
+// Split a treap into the nodes ordered before node and the rest
+// (order is by start time, then trip index)
+void intervalSplit(IntervalNode *nodes, int root, int node, int *left, int *right) {
+    if (root == -1) {
+        *left = -1;
+        *right = -1;
+        return;
+    }
+    
+    if (nodes[root].start < nodes[node].start || (nodes[root].start == nodes[node].start && root < node)) {
+        intervalSplit(nodes, nodes[root].right, node, &nodes[root].right, right);
+        *left = root;
+    } else {
+        intervalSplit(nodes, nodes[root].left, node, left, &nodes[root].left);
+        *right = root;
+    }
+    intervalUpdate(nodes, root);
+}
+
+// Add a trip's window to the tree of a bus or driver
+void scheduleInsert(ScheduleIndex *index, const char *key, int tripIndex, int start, int end) {
+    int tree = scheduleFindTree(index, key);
+    if (tree == -1) {
+        // Take a recycled tree or a new one
+        if (index->freeTree != -1) {
+            tree = index->freeTree;
+            index->freeTree = index->trees[tree].next;
+        } else {
+            tree = index->treeCount++;
+        }
+        
+        unsigned int bucket = hashString(key, SCHEDULE_HASH_SIZE);
+        strncpy(index->trees[tree].key, key, MAX_FOLDED - 1);
+        index->trees[tree].key[MAX_FOLDED - 1] = '\0';
+        index->trees[tree].root = -1;
+        index->trees[tree].tripCount = 0;
+        index->trees[tree].next = index->hashHead[bucket];
+        index->hashHead[bucket] = tree;
+    }
+    
+    IntervalNode *node = &index->nodes[tripIndex];
+    node->start = start;
+    node->end = end;
+    node->maxEnd = end;
+    node->priority = (unsigned int)(tripIndex + 1) * 2654435761u; // Fixed but well spread
+    node->left = -1;
+    node->right = -1;
+    
+    int left, right;
+    intervalSplit(index->nodes, index->trees[tree].root, tripIndex, &left, &right);
+    index->trees[tree].root = intervalMerge(index->nodes, intervalMerge(index->nodes, left, tripIndex), right);
+    index->trees[tree].tripCount++;
+    index->treeOf[tripIndex] = tree;
+}
+
+// Take a trip out of its bus or driver tree
+void scheduleRemove(ScheduleIndex *index, int tripIndex) {
+    int tree = index->treeOf[tripIndex];
+    if (tree == -1) {
+        return;
+    }
+    
+    // Walk down to the trip's node and replace it by its merged children
+    IntervalNode *nodes = index->nodes;
+    int *link = &index->trees[tree].root;
+    int path[MAX_TRIPS];
+    int depth = 0;
+    while (*link != tripIndex) {
+        int current = *link;
+        path[depth++] = current;
+        if (nodes[current].start < nodes[tripIndex].start ||
+            (nodes[current].start == nodes[tripIndex].start && current < tripIndex)) {
+            link = &nodes[current].right;
+        } else {
+            link = &nodes[current].left;
+        }
+    }
+    *link = intervalMerge(nodes, nodes[tripIndex].left, nodes[tripIndex].right);
+    while (depth > 0) {
+        intervalUpdate(nodes, path[--depth]);
+    }
+    
+    index->treeOf[tripIndex] = -1;
+    if (--index->trees[tree].tripCount == 0) {
+        // Unlink the empty tree from its bucket and recycle it
+        int *bucketLink = &index->hashHead[hashString(index->trees[tree].key, SCHEDULE_HASH_SIZE)];
+        while (*bucketLink != tree) {
+            bucketLink = &index->trees[*bucketLink].next;
+        }
+        *bucketLink = index->trees[tree].next;
+        index->trees[tree].next = index->freeTree;
+        index->freeTree = tree;
+    }
+}
+
+// Find a trip of a bus or driver overlapping [start, end) (returns trip index, -1 if none)
+int scheduleFindOverlap(const ScheduleIndex *index, const char *key, int start, int end) {
+    int tree = scheduleFindTree(index, key);
+    if (tree == -1) {
+        return -1;
+    }
+    
+    // If the left subtree reaches past start but has no overlap, nothing
+    // to the right can overlap either, so one path down is enough
+    const IntervalNode *nodes = index->nodes;
+    int node = index->trees[tree].root;
+    while (node != -1) {
+        if (nodes[node].start < end && start < nodes[node].end) {
+            return node;
+        }
+        if (nodes[node].left != -1 && nodes[nodes[node].left].maxEnd > start) {
+            node = nodes[node].left;
+        } else if (nodes[node].start < end) {
+            node = nodes[node].right;
+        } else {
+            break;
+        }
+    }
+    return -1;
+}
+
+// Collect, in time order, the trips of a subtree that end after from
+// (returns the new count of tripIndexes)
+int scheduleCollect(const ScheduleIndex *index, int root, int from, int *tripIndexes, int count) {
+    if (root == -1 || index->nodes[root].maxEnd <= from) {
+        return count;
+    }
+    count = scheduleCollect(index, index->nodes[root].left, from, tripIndexes, count);
+    if (index->nodes[root].end > from) {
+        tripIndexes[count++] = root;
+    }
+    return scheduleCollect(index, index->nodes[root].right, from, tripIndexes, count);
+}
+
+// Add an active trip to its bus and driver schedules
+void scheduleTrip(int tripIndex) {
+    int start, end;
+    if (trips[tripIndex].isActive != 1 || !getTripWindow(&trips[tripIndex], &start, &end)) {
+        return;
+    }
+    
+    char key[MAX_FOLDED];
+    makeBusKey(trips[tripIndex].busLicensePlate, key, sizeof(key));
+    if (key[0]) {
+        scheduleInsert(&busSchedule, key, tripIndex, start, end);
+    }
+    foldName(trips[tripIndex].driverName, key, sizeof(key));
+    if (key[0]) {
+        scheduleInsert(&driverSchedule, key, tripIndex, start, end);
+    }
+}
+
+// Take a trip out of the bus and driver schedules (call before changing it)
+void unscheduleTrip(int tripIndex) {
+    scheduleRemove(&busSchedule, tripIndex);
+    scheduleRemove(&driverSchedule, tripIndex);
+}
+
+// Check that a trip's bus and driver are not on another trip at the same
+// time (tripIndex is the trip being changed, -1 for a new one). Returns 0
+// after reporting the clash.
+int checkScheduleConflicts(const Trip *trip, int tripIndex) {
+    int start, end;
+    if (!getTripWindow(trip, &start, &end)) {
+        return 1; // Trips without a readable time cannot be placed
+    }
+    
+    char busKey[MAX_FOLDED], driverKey[MAX_FOLDED];
+    makeBusKey(trip->busLicensePlate, busKey, sizeof(busKey));
+    foldName(trip->driverName, driverKey, sizeof(driverKey));
+    
+    // The trip's own current window is no clash
+    if (tripIndex != -1) {
+        unscheduleTrip(tripIndex);
+    }
+    int busClash = busKey[0] ? scheduleFindOverlap(&busSchedule, busKey, start, end) : -1;
+    int driverClash = driverKey[0] ? scheduleFindOverlap(&driverSchedule, driverKey, start, end) : -1;
+    if (tripIndex != -1) {
+        scheduleTrip(tripIndex);
+    }
+    
+    if (busClash != -1) {
+        printf("Error: Bus %s is already on Trip ID %d (%s %s)!\n", trip->busLicensePlate,
+               trips[busClash].tripID, trips[busClash].tripDate, trips[busClash].departureTime);
+    }
+    if (driverClash != -1) {
+        printf("Error: Driver %s is already on Trip ID %d (%s %s)!\n", trip->driverName,
+               trips[driverClash].tripID, trips[driverClash].tripDate, trips[driverClash].departureTime);
+    }
+    return busClash == -1 && driverClash == -1;
+}
+
+// Check quietly whether a new trip's bus and driver are free for its window
+int isScheduleFree(const Trip *trip) {
+    int start, end;
+    if (!getTripWindow(trip, &start, &end)) {
+        return 1;
+    }
+    
+    char busKey[MAX_FOLDED], driverKey[MAX_FOLDED];
+    makeBusKey(trip->busLicensePlate, busKey, sizeof(busKey));
+    foldName(trip->driverName, driverKey, sizeof(driverKey));
+    return (!busKey[0] || scheduleFindOverlap(&busSchedule, busKey, start, end) == -1) &&
+           (!driverKey[0] || scheduleFindOverlap(&driverSchedule, driverKey, start, end) == -1);
+}
+
+// Show the upcoming trips of one bus or driver
+void showSchedule() {
+    printf("\n========================================\n");
+    printf("         BUS / DRIVER SCHEDULE\n");
+    printf("========================================\n");
+    
+    int choice;
+    printf("1. Bus\n");
+    printf("2. Driver\n");
+    printf("Enter your choice: ");
+    scanf("%d", &choice);
+    clearInputBuffer();
+    
+    if (choice != 1 && choice != 2) {
+        printf("\n\t[!] Invalid choice!\n");
+        return;
+    }
+    
+    char name[MAX_STRING];
+    printf(choice == 1 ? "Enter Bus License Plate: " : "Enter Driver's Full Name: ");
+    fgets(name, MAX_STRING, stdin);
+    name[strcspn(name, "\n")] = 0;
+    
+    char date[MAX_STRING];
+    printf("From Date (DD/MM/YYYY, empty for all): ");
+    fgets(date, MAX_STRING, stdin);
+    date[strcspn(date, "\n")] = 0;
+    
+    int from = 0;
+    if (date[0]) {
+        int day;
+        if (!parseDate(date, &day)) {
+            printf("Error: Invalid date! Use DD/MM/YYYY.\n");
+            return;
+        }
+        from = day * MINUTES_PER_DAY;
+    }
+    
+    char key[MAX_FOLDED];
+    const ScheduleIndex *index = choice == 1 ? &busSchedule : &driverSchedule;
+    if (choice == 1) {
+        makeBusKey(name, key, sizeof(key));
+    } else {
+        foldName(name, key, sizeof(key));
+    }
+    
+    int tree = scheduleFindTree(index, key);
+    int found[MAX_TRIPS];
+    int count = tree == -1 ? 0 : scheduleCollect(index, index->trees[tree].root, from, found, 0);
+    if (count == 0) {
+        printf("\nNo trips found for %s.\n", name);
+        return;
+    }
+    
+    printf("\n%-8s %-12s %-7s %-7s %-35s %-20s\n", "Trip ID", "Date", "Dep.", "Arr.", "Route",
+           choice == 1 ? "Driver" : "Bus");
+    printf("--------------------------------------------------------------------------------------------\n");
+    for (int i = 0; i < count; i++) {
+        Trip *trip = &trips[found[i]];
+        char route[MAX_STRING * 2 + 8];
+        snprintf(route, sizeof(route), "%s -> %s", trip->departurePoint, trip->arrivalPoint);
+        printf("%-8d %-12s %-7s %-7s %-35s %-20s\n", trip->tripID, trip->tripDate, trip->departureTime,
+               trip->arrivalTime[0] ? trip->arrivalTime : "-", route,
+               choice == 1 ? trip->driverName : trip->busLicensePlate);
+    }
+    printf("\nTotal: %d trip(s)\n", count);
+}
+
+// Forget all cities and connections (the trips are added again by indexTrip)
+void resetConnections() {
+    for (int i = 0; i < CITY_HASH_SIZE; i++) cityHashHead[i] = -1;
+    cityCount = 0;
+    connectionCount = 0;
+}
+
+// Look up a city by name, ignoring case and extra spaces. With add set a
+// new city is created. Returns -1 if the city is unknown or the table is full.
+int findCity(const char *name, int add) {
+    char key[MAX_FOLDED];
+    foldName(name, key, sizeof(key));
+    unsigned int bucket = hashString(key, CITY_HASH_SIZE);
+    for (int i = cityHashHead[bucket]; i != -1; i = cityHashNext[i]) {
+        if (strcmp(cityNames[i], key) == 0) {
+            return i;
+        }
+    }
+    
+    if (!add || cityCount == MAX_CITIES) {
+        return -1;
+    }
+    strcpy(cityNames[cityCount], key);
+    cityHashNext[cityCount] = cityHashHead[bucket];
+    cityHashHead[bucket] = cityCount;
+    return cityCount++;
+}
+
+// Put an active trip into the route graph, keeping departure order
+void addConnection(int tripIndex) {
+    Connection connection;
+    if (trips[tripIndex].isActive != 1 ||
+        !getTripWindow(&trips[tripIndex], &connection.departure, &connection.arrival)) {
+        return; // Trips without a readable time cannot be planned with
+    }
+    
+    connection.fromCity = findCity(trips[tripIndex].departurePoint, 1);
+    connection.toCity = findCity(trips[tripIndex].arrivalPoint, 1);
+    if (connection.fromCity == -1 || connection.toCity == -1) {
+        // Renamed routes left unused cities behind; start the table over
+        resetConnections();
+        for (int i = 0; i < tripCount; i++) {
+            if (i != tripIndex) {
+                addConnection(i);
+            }
+        }
+        connection.fromCity = findCity(trips[tripIndex].departurePoint, 1);
+        connection.toCity = findCity(trips[tripIndex].arrivalPoint, 1);
+    }
+    connection.tripIndex = tripIndex;
+    connection.tripID = trips[tripIndex].tripID;
+    insertConnection(&connection);
+}
+
+// Put a connection into the route graph, keeping departure order
+void insertConnection(const Connection *connection) {
+    // Binary search for the insert position
+    int low = 0, high = connectionCount;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (connections[middle].departure <= connection->departure) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    memmove(&connections[low + 1], &connections[low], sizeof(Connection) * (connectionCount - low));
+    connections[low] = *connection;
+    connectionCount++;
+}
+
+// Add the recurring trips' instances that leave in the days a search
+// starting on startDay covers, without making them real trips. Instances
+// already made are in the graph as trips, or were deleted.
+void addInstanceConnections(int startDay) {
+    int today = getCurrentDay();
+    for (int t = 0; t < templateCount; t++) {
+        int firstDay;
+        if (templates[t].isActive != 1 || !parseDate(templates[t].firstDate, &firstDay)) {
+            continue;
+        }
+        
+        for (int day = startDay > today ? startDay : today; day < startDay + JOURNEY_DAYS; day++) {
+            int offset = day - firstDay;
+            if (offset < 0 || offset >= RECURRING_MAX_DAYS) {
+                continue;
+            }
+            
+            // Dates the bus or driver cannot run would not be sold either
+            Trip trip;
+            Connection connection;
+            connection.tripID = RECURRING_ID_BASE + templates[t].templateID * RECURRING_MAX_DAYS + offset;
+            if (findTripRecord(connection.tripID) != -1 || !makeInstanceTrip(connection.tripID, &trip) ||
+                !isScheduleFree(&trip) || !getTripWindow(&trip, &connection.departure, &connection.arrival)) {
+                continue;
+            }
+            
+            connection.fromCity = findCity(trip.departurePoint, 1);
+            connection.toCity = findCity(trip.arrivalPoint, 1);
+            if (connection.fromCity == -1 || connection.toCity == -1) {
+                continue;
+            }
+            connection.tripIndex = -1;
+            insertConnection(&connection);
+        }
+    }
+}
+
+// Take the recurring trips' instances out of the route graph again
+void removeInstanceConnections() {
+    int kept = 0;
+    for (int i = 0; i < connectionCount; i++) {
+        if (connections[i].tripIndex != -1) {
+            connections[kept++] = connections[i];
+        }
+    }
+    connectionCount = kept;
+}
+
+// Take a trip out of the route graph (call before changing its route or times)
+void removeConnection(int tripIndex) {
+    for (int i = 0; i < connectionCount; i++) {
+        if (connections[i].tripIndex == tripIndex) {
+            memmove(&connections[i], &connections[i + 1], sizeof(Connection) * (connectionCount - i - 1));
+            connectionCount--;
+            return;
+        }
+    }
+}
+
+// Earliest arrival at every city using at most 1, 2, ... MAX_JOURNEY_LEGS
+// trips (arrival[round][city], INT_MAX if not reached). Round r only boards
+// at cities reached in round r - 1, so the first round reaching a city is
+// the one with the fewest transfers. via[round][city] is the connection
+// that improved the city in that round, or -1.
+void scanConnections(int fromCity, int toCity, int start, int transferMinutes,
+                     int arrival[][MAX_CITIES], int via[][MAX_CITIES]) {
+    for (int city = 0; city < cityCount; city++) {
+        arrival[0][city] = INT_MAX;
+        via[0][city] = -1;
+    }
+    arrival[0][fromCity] = start;
+    
+    // Skip the connections that leave before the journey starts
+    int first = 0, high = connectionCount;
+    while (first < high) {
+        int middle = (first + high) / 2;
+        if (connections[middle].departure < start) {
+            first = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    
+    for (int round = 1; round <= MAX_JOURNEY_LEGS; round++) {
+        memcpy(arrival[round], arrival[round - 1], sizeof(int) * cityCount);
+        for (int city = 0; city < cityCount; city++) {
+            via[round][city] = -1;
+        }
+        
+        for (int i = first; i < connectionCount; i++) {
+            const Connection *connection = &connections[i];
+            
+            // Later departures cannot beat the best arrival found so far
+            if (connection->departure >= arrival[round][toCity]) {
+                break;
+            }
+            
+            int ready = arrival[round - 1][connection->fromCity];
+            if (ready == INT_MAX) {
+                continue;
+            }
+            if (connection->fromCity != fromCity) {
+                ready += transferMinutes;
+            }
+            if (connection->departure < ready ||
+                (connection->tripIndex != -1 && trips[connection->tripIndex].availableSeats <= 0)) {
+                continue;
+            }
+            if (connection->arrival < arrival[round][connection->toCity]) {
+                arrival[round][connection->toCity] = connection->arrival;
+                via[round][connection->toCity] = i;
+            }
+        }
+    }
+}
+
+// Walk back from the destination to list a journey's connections in order
+int collectJourney(int round, int fromCity, int toCity, int via[][MAX_CITIES], int *legs) {
+    int count = 0;
+    int city = toCity;
+    for (; round > 0 && city != fromCity; round--) {
+        if (via[round][city] == -1) {
+            continue; // Reached in an earlier round already
+        }
+        legs[count++] = via[round][city];
+        city = connections[via[round][city]].fromCity;
+    }
+    
+    for (int i = 0; i < count / 2; i++) {
+        int swap = legs[i];
+        legs[i] = legs[count - 1 - i];
+        legs[count - 1 - i] = swap;
+    }
+    return count;
+}
+
+// Format minutes since 1970 as DD/MM/YYYY HH:MM
+void formatMinutes(int minutes, char *buffer, size_t size) {
+    time_t seconds = (time_t)minutes * 60;
+    struct tm t;
+    if (gmtime_r(&seconds, &t) == NULL) {
+        snprintf(buffer, size, "-");
+        return;
+    }
+    snprintf(buffer, size, "%02d/%02d/%04d %02d:%02d",
+             t.tm_mday, t.tm_mon + 1, t.tm_year + 1900, t.tm_hour, t.tm_min);
+}
+
+// Print the legs of a journey with the waits between them
+void printJourney(const int *legs, int legCount) {
+    long long totalKurus = 0;
+    char departure[32], arrival[32];
+    
+    for (int i = 0; i < legCount; i++) {
+        const Connection *connection = &connections[legs[i]];
+        Trip instance;
+        const Trip *trip = &instance;
+        if (connection->tripIndex != -1) {
+            trip = &trips[connection->tripIndex];
+        } else {
+            makeInstanceTrip(connection->tripID, &instance);
+        }
+        if (i > 0) {
+            int wait = connection->departure - connections[legs[i - 1]].arrival;
+            printf("     change in %s, wait %dh %02dm\n", trip->departurePoint, wait / 60, wait % 60);
+        }
+        
+        formatMinutes(connection->departure, departure, sizeof(departure));
+        formatMinutes(connection->arrival, arrival, sizeof(arrival));
+        printf("  %d. Trip ID %-5d %s -> %s\n", i + 1, trip->tripID, trip->departurePoint, trip->arrivalPoint);
+        printf("     %s -> %s%s, %d seat(s) left, %.2f TL\n", departure, arrival,
+               trip->arrivalTime[0] ? "" : " (estimated)", trip->availableSeats, trip->ticketPrice);
+        totalKurus += priceToKurus(trip->ticketPrice);
+    }
+    
+    char total[32];
+    formatKurus(totalKurus, total, sizeof(total));
+    formatMinutes(connections[legs[legCount - 1]].arrival, arrival, sizeof(arrival));
+    printf("  Arrives %s, %d transfer(s), total %s TL\n", arrival, legCount - 1, total);
+}
+
+// Find connecting trips with free seats between two cities
+void planJourney() {
+    printf("\n========================================\n");
+    printf("           PLAN JOURNEY\n");
+    printf("========================================\n");
+    
+    char from[MAX_STRING], to[MAX_STRING], date[MAX_STRING], startTime[MAX_STRING], transfer[MAX_STRING];
+    printf("From: ");
+    fgets(from, MAX_STRING, stdin);
+    from[strcspn(from, "\n")] = 0;
+    printf("To: ");
+    fgets(to, MAX_STRING, stdin);
+    to[strcspn(to, "\n")] = 0;
+    printf("Travel Date (DD/MM/YYYY): ");
+    fgets(date, MAX_STRING, stdin);
+    date[strcspn(date, "\n")] = 0;
+    printf("Earliest Departure Time (HH:MM, empty for 00:00): ");
+    fgets(startTime, MAX_STRING, stdin);
+    startTime[strcspn(startTime, "\n")] = 0;
+    printf("Minimum Transfer Time in minutes (empty for %d): ", DEFAULT_TRANSFER_MINUTES);
+    fgets(transfer, MAX_STRING, stdin);
+    transfer[strcspn(transfer, "\n")] = 0;
+    
+    int day, minutes = 0;
+    if (!parseDate(date, &day)) {
+        printf("Error: Invalid date! Use DD/MM/YYYY.\n");
+        return;
+    }
+    if (startTime[0] && !parseTime(startTime, &minutes)) {
+        printf("Error: Invalid time! Use HH:MM.\n");
+        return;
+    }
+    int transferMinutes = transfer[0] ? atoi(transfer) : DEFAULT_TRANSFER_MINUTES;
+    if (transferMinutes < 0) {
+        printf("Error: Transfer time cannot be negative!\n");
+        return;
+    }
+    
+    // Recurring trips take part on the dates the search can reach
+    addInstanceConnections(day);
+    int fromCity = findCity(from, 0);
+    int toCity = findCity(to, 0);
+    if (fromCity == -1 || toCity == -1 || fromCity == toCity) {
+        printf("\nNo trips found between %s and %s.\n", from, to);
+    } else {
+        showJourneys(fromCity, toCity, day * MINUTES_PER_DAY + minutes, transferMinutes);
+    }
+    removeInstanceConnections();
+}
+
+// Search the route graph and print the earliest and fewest-transfer journeys
+void showJourneys(int fromCity, int toCity, int start, int transferMinutes) {
+    int arrival[MAX_JOURNEY_LEGS + 1][MAX_CITIES];
+    int via[MAX_JOURNEY_LEGS + 1][MAX_CITIES];
+    scanConnections(fromCity, toCity, start, transferMinutes, arrival, via);
+    
+    // Fewest transfers is the first round that arrives; earliest arrival
+    // is the first round that reaches the best time
+    int fewest = 0, earliest = 0;
+    for (int round = 1; round <= MAX_JOURNEY_LEGS; round++) {
+        if (fewest == 0 && arrival[round][toCity] != INT_MAX) {
+            fewest = round;
+        }
+        if (arrival[round][toCity] < arrival[earliest][toCity]) {
+            earliest = round;
+        }
+    }
+    if (fewest == 0) {
+        printf("\nNo journey with free seats found within %d trips.\n", MAX_JOURNEY_LEGS);
+        return;
+    }
+    
+    int legs[MAX_JOURNEY_LEGS];
+    int legCount = collectJourney(earliest, fromCity, toCity, via, legs);
+    printf("\n--- Earliest Arrival ---\n");
+    printJourney(legs, legCount);
+    
+    if (fewest != earliest) {
+        legCount = collectJourney(fewest, fromCity, toCity, via, legs);
+        printf("\n--- Fewest Transfers ---\n");
+        printJourney(legs, legCount);
+    }
+}
+
+// Format days since 1970 as DD/MM/YYYY
+void formatDay(int day, char *buffer, size_t size) {
+    time_t seconds = (time_t)day * 86400;
+    struct tm t;
+    if (gmtime_r(&seconds, &t) == NULL) {
+        snprintf(buffer, size, "-");
+        return;
+    }
+    snprintf(buffer, size, "%02d/%02d/%04d", t.tm_mday, t.tm_mon + 1, t.tm_year + 1900);
+}
+
+// Save all recurring trip templates to file
+void saveTemplatesToFile() {
+    requestSave(SAVE_TEMPLATES);
+}
+
+// Write the first count templates to templates.txt (returns 0 if it was not written)
+int writeTemplatesFile(int count) {
+    char tempName[MAX_STRING];
+    FILE *file = openDataFile("templates.txt", tempName, sizeof(tempName));
+    if (file == NULL) {
+        printf("Error: Could not open templates file for writing!\n");
+        return 0;
+    }
+    
+    fprintf(file, "%d\n", count);
+    for (int i = 0; i < count; i++) {
+        writeTemplateRecord(file, &templates[i]);
+    }
+    
+    return closeDataFile(file, tempName, "templates.txt");
+}
+
+// Write one template line
+void writeTemplateRecord(FILE *file, const TripTemplate *tripTemplate) {
+    fprintf(file, "%d|%s|%s|%s|%s|%s|%s|%s|%d|%.2f|%d|%s|%s|%d\n",
+            tripTemplate->templateID,
+            tripTemplate->departurePoint,
+            tripTemplate->arrivalPoint,
+            tripTemplate->stops,
+            tripTemplate->departureTime,
+            tripTemplate->arrivalTime,
+            tripTemplate->busLicensePlate,
+            tripTemplate->driverName,
+            tripTemplate->totalSeats,
+            tripTemplate->ticketPrice,
+            tripTemplate->weekdays,
+            tripTemplate->firstDate,
+            tripTemplate->lastDate,
+            tripTemplate->isActive);
+}
+
+// Parse one template line (returns a RECORD_* result)
+int parseTemplateRecord(const Field *fields, int fieldCount, void *record) {
+    TripTemplate *tripTemplate = (TripTemplate *)record;
+    if (fieldCount != 14) {
+        return RECORD_BAD_FIELD_COUNT;
+    }
+    
+    if (!parseIntField(&fields[0], &tripTemplate->templateID) ||
+        !parseIntField(&fields[8], &tripTemplate->totalSeats) ||
+        !parsePriceField(&fields[9], &tripTemplate->ticketPrice) ||
+        !parseIntField(&fields[10], &tripTemplate->weekdays) ||
+        !parseIntField(&fields[13], &tripTemplate->isActive)) {
+        return RECORD_BAD_NUMBER;
+    }
+    
+    int truncated = 0;
+    truncated |= copyTextField(tripTemplate->departurePoint, &fields[1]);
+    truncated |= copyTextField(tripTemplate->arrivalPoint, &fields[2]);
+    truncated |= copyTextField(tripTemplate->stops, &fields[3]);
+    truncated |= copyTextField(tripTemplate->departureTime, &fields[4]);
+    truncated |= copyTextField(tripTemplate->arrivalTime, &fields[5]);
+    truncated |= copyTextField(tripTemplate->busLicensePlate, &fields[6]);
+    truncated |= copyTextField(tripTemplate->driverName, &fields[7]);
+    truncated |= copyTextField(tripTemplate->firstDate, &fields[11]);
+    truncated |= copyTextField(tripTemplate->lastDate, &fields[12]);
+    return truncated ? RECORD_TRUNCATED : RECORD_OK;
+}
+
+// Load all recurring trip templates from file
+void loadTemplatesFromFile() {
+    int loaded = loadRecordsFromFile("templates.txt", templates, sizeof(TripTemplate), MAX_TEMPLATES,
+                                     parseTemplateRecord);
+    templateCount = loaded > 0 ? loaded : 0;
+    if (templateCount > 0) {
+        printf("Loaded %d recurring trips from file.\n", templateCount);
+    }
+}
+
+// Find template by ID (returns index, -1 if not found)
+int findTemplateByID(int templateID) {
+    for (int i = 0; i < templateCount; i++) {
+        if (templates[i].templateID == templateID) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Get the date of a template's instance (returns 0 if the template does
+// not run on that day)
+int getInstanceDay(const TripTemplate *tripTemplate, int dayOffset, int *day) {
+    int firstDay, lastDay;
+    if (!parseDate(tripTemplate->firstDate, &firstDay) || !parseDate(tripTemplate->lastDate, &lastDay)) {
+        return 0;
+    }
+    
+    *day = firstDay + dayOffset;
+    int weekday = (*day + 3) % 7; // 01/01/1970 was a Thursday, Monday is 0
+    return dayOffset >= 0 && *day <= lastDay && (tripTemplate->weekdays >> weekday) & 1;
+}
+
+// Turn a recurring trip's instance ID into a real trip. Returns the trip
+// index, or -1 if the ID is no upcoming instance or it cannot be added.
+int materializeInstance(int tripID) {
+    // A standby only shows instances the primary has made
+    if (tripID < RECURRING_ID_BASE || replicaRole == REPLICA_STANDBY) {
+        return -1;
+    }
+    int templateID = (tripID - RECURRING_ID_BASE) / RECURRING_MAX_DAYS;
+    
+    beginSharedUpdate();
+    
+    // Another counter may have made it meanwhile
+    int index = findTripByID(tripID);
+    if (index != -1) {
+        endSharedUpdate(0);
+        return index;
+    }
+    
+    // A deleted instance keeps its record and is not brought back
+    Trip trip;
+    if (findTripRecord(tripID) != -1 || !makeInstanceTrip(tripID, &trip)) {
+        endSharedUpdate(0);
+        return -1;
+    }
+    if (tripCount >= MAX_TRIPS) {
+        printf("Error: Maximum trip limit reached!\n");
+        endSharedUpdate(0);
+        return -1;
+    }
+    
+    // The bus or driver may have been given another trip that day
+    if (!checkScheduleConflicts(&trip, -1)) {
+        printf("Error: Recurring trip %d cannot run on %s!\n", templateID, trip.tripDate);
+        endSharedUpdate(0);
+        return -1;
+    }
+    
+    index = tripCount;
+    trips[tripCount] = trip;
+    indexTrip(tripCount);
+    tripCount++;
+    
+    saveTripsToFile();
+    endSharedUpdate(1);
+    return index;
+}
+
+// Fill in the trip a recurring trip's instance ID stands for (returns 0
+// if the ID is no upcoming date of an active recurring trip)
+int makeInstanceTrip(int tripID, Trip *trip) {
+    if (tripID < RECURRING_ID_BASE) {
+        return 0;
+    }
+    int t = findTemplateByID((tripID - RECURRING_ID_BASE) / RECURRING_MAX_DAYS);
+    int day;
+    if (t == -1 || templates[t].isActive != 1 ||
+        !getInstanceDay(&templates[t], (tripID - RECURRING_ID_BASE) % RECURRING_MAX_DAYS, &day) ||
+        day < getCurrentDay()) {
+        return 0;
+    }
+    
+    memset(trip, 0, sizeof(*trip));
+    trip->tripID = tripID;
+    strcpy(trip->departurePoint, templates[t].departurePoint);
+    strcpy(trip->arrivalPoint, templates[t].arrivalPoint);
+    formatDay(day, trip->tripDate, sizeof(trip->tripDate));
+    strcpy(trip->departureTime, templates[t].departureTime);
+    strcpy(trip->busLicensePlate, templates[t].busLicensePlate);
+    strcpy(trip->driverName, templates[t].driverName);
+    trip->totalSeats = templates[t].totalSeats;
+    trip->availableSeats = templates[t].totalSeats;
+    trip->ticketPrice = templates[t].ticketPrice;
+    trip->isActive = 1;
+    strcpy(trip->stops, templates[t].stops);
+    strcpy(trip->arrivalTime, templates[t].arrivalTime);
+    return 1;
+}
+
+// Find a trip's record by ID, deleted trips included (returns -1 if none)
+int findTripRecord(int tripID) {
+    for (int i = tripHashHead[hashID(tripID, TRIP_HASH_SIZE)]; i != -1; i = tripHashNext[i]) {
+        if (trips[i].tripID == tripID) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Find trip by ID, making a recurring trip's instance on first use
+int findTripOrInstance(int tripID) {
+    int index = findTripByID(tripID);
+    return index != -1 ? index : materializeInstance(tripID);
+}
+
+// Recurring trips menu
+void manageTemplates() {
+    printf("\n========================================\n");
+    printf("          RECURRING TRIPS\n");
+    printf("========================================\n");
+    
+    int choice;
+    printf("1. Create Recurring Trip\n");
+    printf("2. List Recurring Trips\n");
+    printf("3. Stop Recurring Trip\n");
+    printf("Enter your choice: ");
+    scanf("%d", &choice);
+    clearInputBuffer();
+    
+    switch (choice) {
+        case 1: createTemplate(); break;
+        case 2: listTemplates(); break;
+        case 3: stopTemplate(); break;
+        default: printf("\n\t[!] Invalid choice!\n");
+    }
+}
+
+// Create a recurring trip template
+void createTemplate() {
+    if (templateCount >= MAX_TEMPLATES) {
+        printf("Error: Maximum recurring trip limit reached!\n");
+        return;
+    }
+    
+    TripTemplate newTemplate;
+    memset(&newTemplate, 0, sizeof(newTemplate));
+    
+    printf("Enter Departure Point: ");
+    fgets(newTemplate.departurePoint, MAX_STRING, stdin);
+    newTemplate.departurePoint[strcspn(newTemplate.departurePoint, "\n")] = 0;
+    
+    printf("Enter Arrival Point: ");
+    fgets(newTemplate.arrivalPoint, MAX_STRING, stdin);
+    newTemplate.arrivalPoint[strcspn(newTemplate.arrivalPoint, "\n")] = 0;
+    
+    printf("Enter Intermediate Stops (comma separated, empty for none): ");
+    fgets(newTemplate.stops, MAX_STRING, stdin);
+    newTemplate.stops[strcspn(newTemplate.stops, "\n")] = 0;
+    if (!validateStops(newTemplate.stops)) {
+        return;
+    }
+    
+    int departure, arrival;
     printf("Enter Departure Time (HH:MM): ");
-    fgets(newTrip.departureTime, MAX_STRING, stdin);
-    newTrip.departureTime[strcspn(newTrip.departureTime, "\n")] = 0;
+    fgets(newTemplate.departureTime, MAX_STRING, stdin);
+    newTemplate.departureTime[strcspn(newTemplate.departureTime, "\n")] = 0;
+    if (!parseTime(newTemplate.departureTime, &departure)) {
+        printf("Error: Invalid time! Use HH:MM.\n");
+        return;
+    }
+    
+    printf("Enter Arrival Time (HH:MM, empty if unknown): ");
+    fgets(newTemplate.arrivalTime, MAX_STRING, stdin);
+    newTemplate.arrivalTime[strcspn(newTemplate.arrivalTime, "\n")] = 0;
+    if (newTemplate.arrivalTime[0] && !parseTime(newTemplate.arrivalTime, &arrival)) {
+        printf("Error: Invalid time! Use HH:MM.\n");
+        return;
+    }
     
-    // Get Bus License Plate
     printf("Enter Bus License Plate: ");
-    fgets(newTrip.busLicensePlate, MAX_STRING, stdin);
-    newTrip.busLicensePlate[strcspn(newTrip.busLicensePlate, "\n")] = 0;
+    fgets(newTemplate.busLicensePlate, MAX_STRING, stdin);
+    newTemplate.busLicensePlate[strcspn(newTemplate.busLicensePlate, "\n")] = 0;
     
-    // Get Driver's Full Name
-    printf("Enter Driver's Full Name: ");
-    fgets(newTrip.driverName, MAX_STRING, stdin);
-    newTrip.driverName[strcspn(newTrip.driverName, "\n")] = 0;
+    printf("Enter Driver Name: ");
+    fgets(newTemplate.driverName, MAX_STRING, stdin);
+    newTemplate.driverName[strcspn(newTemplate.driverName, "\n")] = 0;
     
-    // Get Number of Seats
-    printf("Enter Number of Seats: ");
-    scanf("%d", &newTrip.totalSeats);
+    printf("Enter Total Seats: ");
+    scanf("%d", &newTemplate.totalSeats);
     clearInputBuffer();
-    
-    // Validate seat count
-    if (newTrip.totalSeats <= 0 || newTrip.totalSeats > MAX_SEATS) {
+    if (newTemplate.totalSeats <= 0 || newTemplate.totalSeats > MAX_SEATS) {
         printf("Error: Invalid number of seats! Must be between 1 and %d.\n", MAX_SEATS);
         return;
     }
     
-    // Get Ticket Price
     printf("Enter Ticket Price: ");
-    scanf("%f", &newTrip.ticketPrice);
+    scanf("%f", &newTemplate.ticketPrice);
     clearInputBuffer();
-    
-    // Validate price
-    if (newTrip.ticketPrice <= 0) {
+    if (newTemplate.ticketPrice <= 0) {
         printf("Error: Ticket price must be greater than 0!\n");
         return;
     }
     
-    // Set initial values
-    newTrip.availableSeats = newTrip.totalSeats; // All seats available initially
-    newTrip.isActive = 1; // Trip is active
+    // Days as digits, 1 = Monday ... 7 = Sunday
+    char days[MAX_STRING];
+    printf("Enter Days of Week (e.g. 135 for Mon, Wed, Fri; empty for every day): ");
+    fgets(days, MAX_STRING, stdin);
+    days[strcspn(days, "\n")] = 0;
+    newTemplate.weekdays = days[0] ? 0 : 0x7F;
+    for (const char *p = days; *p; p++) {
+        if (*p < '1' || *p > '7') {
+            printf("Error: Invalid days! Use digits 1 (Monday) to 7 (Sunday).\n");
+            return;
+        }
+        newTemplate.weekdays |= 1 << (*p - '1');
+    }
     
-    // Add trip to array
-    trips[tripCount] = newTrip;
-    tripCount++;
+    int firstDay, lastDay;
+    printf("Enter First Date (DD/MM/YYYY): ");
+    fgets(newTemplate.firstDate, MAX_STRING, stdin);
+    newTemplate.firstDate[strcspn(newTemplate.firstDate, "\n")] = 0;
+    printf("Enter Last Date (DD/MM/YYYY): ");
+    fgets(newTemplate.lastDate, MAX_STRING, stdin);
+    newTemplate.lastDate[strcspn(newTemplate.lastDate, "\n")] = 0;
+    if (!parseDate(newTemplate.firstDate, &firstDay) || !parseDate(newTemplate.lastDate, &lastDay)) {
+        printf("Error: Invalid date! Use DD/MM/YYYY.\n");
+        return;
+    }
+    if (lastDay < firstDay || lastDay - firstDay >= RECURRING_MAX_DAYS) {
+        printf("Error: The last date must be on or after the first date, within %d days!\n", RECURRING_MAX_DAYS);
+        return;
+    }
+    newTemplate.isActive = 1;
     
-    // Save to file
-    saveTripsToFile();
+    beginSharedUpdate();
+    if (templateCount >= MAX_TEMPLATES) {
+        printf("Error: Maximum recurring trip limit reached!\n");
+        endSharedUpdate(0);
+        return;
+    }
     
-    printf("\n✓ Trip created successfully!\n");
-    printf("Trip ID: %d\n", newTrip.tripID);
-    printf("Route: %s -> %s\n", newTrip.departurePoint, newTrip.arrivalPoint);
-    printf("Date: %s at %s\n", newTrip.tripDate, newTrip.departureTime);
+    // IDs are never reused, so old instance IDs keep pointing at their template
+    newTemplate.templateID = 1;
+    for (int i = 0; i < templateCount; i++) {
+        if (templates[i].templateID >= newTemplate.templateID) {
+            newTemplate.templateID = templates[i].templateID + 1;
+        }
+    }
+    if (newTemplate.templateID > (INT_MAX - RECURRING_ID_BASE) / RECURRING_MAX_DAYS - 1) {
+        printf("Error: No recurring trip IDs left!\n");
+        endSharedUpdate(0);
+        return;
+    }
+    
+    templates[templateCount++] = newTemplate;
+    saveTemplatesToFile();
+    endSharedUpdate(1);
+    
+    printf("\n✓ Recurring trip created successfully!\n");
+    printf("Recurring Trip ID: %d\n", newTemplate.templateID);
+    printf("The Trip IDs of its dates are shown under List Recurring Trips.\n");
 }
 
-// Update an existing trip
-void updateTrip() {
-    printf("\n========================================\n");
-    printf("           UPDATE TRIP\n");
-    printf("========================================\n");
+// List the recurring trips with the IDs of their next instances
+void listTemplates() {
+    if (templateCount == 0) {
+        printf("\nNo recurring trips found.\n");
+        return;
+    }
     
-    int tripID;
-    printf("Enter Trip ID to update: ");
-    scanf("%d", &tripID);
+    static const char *dayNames[7] = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
+    int today = getCurrentDay();
+    
+    for (int i = 0; i < templateCount; i++) {
+        TripTemplate *tripTemplate = &templates[i];
+        char days[32] = "";
+        for (int d = 0; d < 7; d++) {
+            if ((tripTemplate->weekdays >> d) & 1) {
+                strcat(days, dayNames[d]);
+                strcat(days, " ");
+            }
+        }
+        
+        printf("\n[%d] %s -> %s at %s, %s%s\n", tripTemplate->templateID, tripTemplate->departurePoint,
+               tripTemplate->arrivalPoint, tripTemplate->departureTime, days,
+               tripTemplate->isActive == 1 ? "" : "(stopped)");
+        printf("    %s to %s, bus %s, driver %s, %d seats, %.2f TL\n", tripTemplate->firstDate,
+               tripTemplate->lastDate, tripTemplate->busLicensePlate, tripTemplate->driverName,
+               tripTemplate->totalSeats, tripTemplate->ticketPrice);
+        if (tripTemplate->isActive != 1) {
+            continue;
+        }
+        
+        // Upcoming dates only; nothing is stored until one is used
+        int firstDay, lastDay, day;
+        if (!parseDate(tripTemplate->firstDate, &firstDay) || !parseDate(tripTemplate->lastDate, &lastDay)) {
+            continue;
+        }
+        int shown = 0;
+        for (int offset = today > firstDay ? today - firstDay : 0;
+             offset <= lastDay - firstDay && shown < UPCOMING_INSTANCES; offset++) {
+            if (!getInstanceDay(tripTemplate, offset, &day)) {
+                continue;
+            }
+            
+            char date[MAX_STRING];
+            formatDay(day, date, sizeof(date));
+            int tripID = RECURRING_ID_BASE + tripTemplate->templateID * RECURRING_MAX_DAYS + offset;
+            int index = findTripByID(tripID);
+            printf("    Trip ID %-8d %s  %d seat(s) left\n", tripID, date,
+                   index != -1 ? trips[index].availableSeats : tripTemplate->totalSeats);
+            shown++;
+        }
+        if (shown == 0) {
+            printf("    No upcoming dates.\n");
+        }
+    }
+}
+
+// Stop making new instances of a recurring trip
+void stopTemplate() {
+    int templateID;
+    printf("Enter Recurring Trip ID to stop: ");
+    scanf("%d", &templateID);
     clearInputBuffer();
     
-    // Find the trip
-    int index = findTripByID(tripID);
-    if (index == -1) {
-        printf("Error: Trip with ID %d not found!\n", tripID);
+    beginSharedUpdate();
+    int index = findTemplateByID(templateID);
+    if (index == -1 || templates[index].isActive != 1) {
+        printf("Error: Recurring trip with ID %d not found!\n", templateID);
+        endSharedUpdate(0);
         return;
     }
+    
+    templates[index].isActive = 0;
+    saveTemplatesToFile();
+    endSharedUpdate(1);
+    
+    printf("\n✓ Recurring trip stopped. Trips already in use are kept.\n");
+}
 
-    // Show warning if any ticket has sold
-    if (trips[index].availableSeats != trips[index].totalSeats) {
-        char confirm;
-        printf("Warning: Some tickets has sold before for this trip.\nThis could cause some confusion.\nDo you still want to change this information: (Y/N) ");
-        scanf("%c", &confirm);
-        if (confirm == 'N' || confirm == 'n') {
-            return;
+// Fill in a Unix socket address (returns 0 if the path is too long)
+int makeReplicaAddress(const char *path, struct sockaddr_un *address) {
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address->sun_path)) {
+        printf("Error: Socket path %s is too long!\n", path);
+        return 0;
+    }
+    strcpy(address->sun_path, path);
+    return 1;
+}
+
+// Listen for a standby on a Unix socket
+int startPrimary(const char *path) {
+    struct sockaddr_un address;
+    if (!makeReplicaAddress(path, &address)) {
+        return 0;
+    }
+    
+    // A socket file nobody answers on was left by a primary that stopped
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe >= 0 && connect(probe, (struct sockaddr *)&address, sizeof(address)) == 0) {
+        printf("Error: Another primary is already using %s!\n", path);
+        close(probe);
+        return 0;
+    }
+    if (probe >= 0) {
+        close(probe);
+    }
+    unlink(path);
+    
+    // Only this user may connect: the socket carries every passenger's details
+    replicaListener = socket(AF_UNIX, SOCK_STREAM, 0);
+    mode_t oldMask = umask(0077);
+    int bound = replicaListener >= 0 && bind(replicaListener, (struct sockaddr *)&address, sizeof(address)) == 0;
+    umask(oldMask);
+    if (!bound || listen(replicaListener, 1) != 0) {
+        printf("Error: Could not listen on %s!\n", path);
+        if (replicaListener >= 0) {
+            close(replicaListener);
+            replicaListener = -1;
         }
+        return 0;
     }
     
-    // Display current trip information
-    printf("\n--- Current Trip Information ---\n");
-    printf("Trip ID: %d\n", trips[index].tripID);
-    printf("Departure Point: %s\n", trips[index].departurePoint);
-    printf("Arrival Point: %s\n", trips[index].arrivalPoint);
-    printf("Trip Date: %s\n", trips[index].tripDate);
-    printf("Departure Time: %s\n", trips[index].departureTime);
-    printf("Bus License Plate: %s\n", trips[index].busLicensePlate);
-    printf("Driver Name: %s\n", trips[index].driverName);
-    printf("Total Seats: %d\n", trips[index].totalSeats);
-    printf("Available Seats: %d\n", trips[index].availableSeats);
-    printf("Ticket Price: %.2f TL\n", trips[index].ticketPrice);
+    strcpy(replicaPath, path);
+    if (replicaRole == REPLICA_NONE) {
+        atexit(closeReplication);
+    }
+    replicaRole = REPLICA_PRIMARY;
+    setvbuf(stdin, NULL, _IONBF, 0); // Nothing may wait unseen in a buffer while polling
+    printf("Primary: standby can connect on %s.\n", path);
+    return 1;
+}
+
+// Follow a primary; the first connection may come later
+int startStandby(const char *path) {
+    struct sockaddr_un address;
+    if (!makeReplicaAddress(path, &address)) {
+        return 0;
+    }
     
-    while (1) {
-    // Update menu
-    int choice;
-    printf("\n--- What would you like to update? ---\n");
-    printf("1. Departure Point\n");
-    printf("2. Arrival Point\n");
-    printf("3. Trip Date\n");
-    printf("4. Departure Time\n");
-    printf("5. Bus License Plate\n");
-    printf("6. Driver Name\n");
-    printf("7. Total Seats\n");
-    printf("8. Ticket Price\n");
-    printf("0. Exit\n");
-    printf("Enter your choice: ");
-    scanf("%d", &choice);
-    clearInputBuffer();
+    strcpy(replicaPath, path);
+    replicaRole = REPLICA_STANDBY;
+    atexit(closeReplication);
     
-    switch(choice) {
-        case 1:
-            printf("Enter new Departure Point: ");
-            fgets(trips[index].departurePoint, MAX_STRING, stdin);
-            trips[index].departurePoint[strcspn(trips[index].departurePoint, "\n")] = 0;
+    // Every keyboard read also takes in the primary's changes (a capture
+    // stream already reads through keyboardRead)
+    if (captureLog == NULL) {
+        cookie_io_functions_t io = {keyboardRead, NULL, NULL, NULL};
+        FILE *input = fopencookie(NULL, "r", io);
+        if (input == NULL) {
+            printf("Error: Could not set up the standby's input!\n");
+            return 0;
+        }
+        stdin = input;
+    }
+    setvbuf(stdin, NULL, _IONBF, 0);
+    
+    replicaSocket = connectToPrimary();
+    if (replicaSocket == -1) {
+        printf("Standby: no primary on %s yet, will keep trying.\n", path);
+    }
+    return 1;
+}
+
+// Check that the other end of a replication socket runs as this user
+int isSameUserPeer(int fd) {
+    struct ucred peer;
+    socklen_t length = sizeof(peer);
+    return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &length) == 0 && peer.uid == getuid();
+}
+
+// Connect to the primary (returns the socket, or -1)
+int connectToPrimary() {
+    struct sockaddr_un address;
+    makeReplicaAddress(replicaPath, &address);
+    
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    static int warned = 0; // Said once, not on every retry
+    if (!isSameUserPeer(fd)) {
+        if (!warned) {
+            printf("\nWarning: %s belongs to another user, not following it.\n", replicaPath);
+            warned = 1;
+        }
+        close(fd);
+        return -1;
+    }
+    warned = 0;
+    
+    replicaInputLength = 0;
+    printf("\nStandby: following the primary on %s.\n", replicaPath);
+    return fd;
+}
+
+// Close the replication sockets (the primary also removes its socket file)
+void closeReplication() {
+    if (replicaSocket != -1) {
+        close(replicaSocket);
+        replicaSocket = -1;
+    }
+    if (replicaListener != -1) {
+        close(replicaListener);
+        replicaListener = -1;
+        unlink(replicaPath);
+    }
+}
+
+// Write a whole buffer to a socket (returns 0 on failure)
+int sendAll(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return 0;
+        }
+        data += sent;
+        size -= sent;
+    }
+    return 1;
+}
+
+// Write archive.dat bytes from..to as A|offset|<hex> lines (returns
+// where it stopped)
+long writeArchiveLines(FILE *out, long from, long to) {
+    static const char digits[] = "0123456789abcdef";
+    unsigned char chunk[REPLICA_ARCHIVE_CHUNK];
+    char hex[REPLICA_ARCHIVE_CHUNK * 2];
+    
+    FILE *file = fopen(ARCHIVE_FILE, "rb");
+    if (file == NULL || fseek(file, from, SEEK_SET) != 0) {
+        if (file != NULL) fclose(file);
+        return from;
+    }
+    
+    long offset = from;
+    while (offset < to) {
+        size_t wanted = to - offset < REPLICA_ARCHIVE_CHUNK ? (size_t)(to - offset) : REPLICA_ARCHIVE_CHUNK;
+        size_t got = fread(chunk, 1, wanted, file);
+        if (got == 0) {
             break;
-            
-        case 2:
-            printf("Enter new Arrival Point: ");
-            fgets(trips[index].arrivalPoint, MAX_STRING, stdin);
-            trips[index].arrivalPoint[strcspn(trips[index].arrivalPoint, "\n")] = 0;
+        }
+        for (size_t i = 0; i < got; i++) {
+            hex[2 * i] = digits[chunk[i] >> 4];
+            hex[2 * i + 1] = digits[chunk[i] & 15];
+        }
+        fprintf(out, "A|%ld|", offset);
+        fwrite(hex, 1, got * 2, out);
+        fputc('\n', out);
+        offset += got;
+    }
+    fclose(file);
+    return offset;
+}
+
+// Send the standby every trip, ticket and template that changed since the
+// last batch, and the archive blocks written since (all of it for a
+// snapshot), as one batch:
+//   B|tripCount|ticketCount|templateCount|lastTicketID|archiveSize
+//   T|index|<trip line>, K|index|<ticket line>, P|index|<template line>
+//   A|offset|<archive bytes in hex>
+//   C
+void shipChanges(int snapshot) {
+    if (replicaRole != REPLICA_PRIMARY || replicaSocket == -1) {
+        return;
+    }
+    
+    char *batch = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&batch, &size);
+    if (out == NULL) {
+        return;
+    }
+    
+    // Only whole blocks are sent; an archive that shrank was replaced
+    refreshArchiveIndex();
+    long archiveFrom = snapshot || archiveIndexedSize < replicaArchiveSize ? 0 : replicaArchiveSize;
+    
+    int changes = snapshot || tripCount != replicaTripCount || ticketCount != replicaTicketCount ||
+                  templateCount != replicaTemplateCount || archiveIndexedSize != replicaArchiveSize;
+    fprintf(out, "B|%d|%d|%d|%d|%ld\n", tripCount, ticketCount, templateCount, lastTicketID, archiveIndexedSize);
+    for (int i = 0; i < tripCount; i++) {
+        if (snapshot || i >= replicaTripCount || memcmp(&trips[i], &replicaTrips[i], sizeof(Trip)) != 0) {
+            fprintf(out, "T|%d|", i);
+            writeTripRecord(out, &trips[i]);
+            replicaTrips[i] = trips[i];
+            changes = 1;
+        }
+    }
+    for (int i = 0; i < ticketCount; i++) {
+        if (snapshot || i >= replicaTicketCount || memcmp(&tickets[i], &replicaTickets[i], sizeof(Ticket)) != 0) {
+            fprintf(out, "K|%d|", i);
+            writeTicketRecord(out, &tickets[i]);
+            replicaTickets[i] = tickets[i];
+            changes = 1;
+        }
+    }
+    for (int i = 0; i < templateCount; i++) {
+        if (snapshot || i >= replicaTemplateCount ||
+            memcmp(&templates[i], &replicaTemplates[i], sizeof(TripTemplate)) != 0) {
+            fprintf(out, "P|%d|", i);
+            writeTemplateRecord(out, &templates[i]);
+            replicaTemplates[i] = templates[i];
+            changes = 1;
+        }
+    }
+    replicaArchiveSize = writeArchiveLines(out, archiveFrom, archiveIndexedSize);
+    fprintf(out, "C\n");
+    fclose(out);
+    
+    replicaTripCount = tripCount;
+    replicaTicketCount = ticketCount;
+    replicaTemplateCount = templateCount;
+    
+    // A standby that cannot keep up is dropped; it gets a snapshot when it reconnects
+    if (changes && !sendAll(replicaSocket, batch, size)) {
+        printf("\nWarning: Lost the standby, it gets a full copy when it reconnects.\n");
+        close(replicaSocket);
+        replicaSocket = -1;
+    }
+    free(batch);
+}
+
+// Value of a lowercase hex digit (-1 if it is not one)
+int hexDigitValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// Apply one received line. Records collect in the replica arrays; the
+// batch replaces the live data when its closing line arrives.
+void applyReplicaLine(const char *line, const char *end) {
+    Field fields[MAX_FIELDS];
+    const char *p = line;
+    int fieldCount = splitFields(&p, end, fields);
+    if (fieldCount < 1 || fields[0].length != 1) {
+        return;
+    }
+    
+    int index;
+    long offset, archiveSize;
+    struct stat info;
+    switch (fields[0].start[0]) {
+        case 'B':
+            if (fieldCount == 6 && parseIntField(&fields[1], &replicaTripCount) &&
+                parseIntField(&fields[2], &replicaTicketCount) && parseIntField(&fields[3], &replicaTemplateCount) &&
+                parseIntField(&fields[4], &replicaLastTicketID) && parseLongField(&fields[5], &replicaArchiveSize)) {
+                if (replicaTripCount > MAX_TRIPS) replicaTripCount = MAX_TRIPS;
+                if (replicaTicketCount > MAX_TICKETS) replicaTicketCount = MAX_TICKETS;
+                if (replicaTemplateCount > MAX_TEMPLATES) replicaTemplateCount = MAX_TEMPLATES;
+            }
+            replicaArchiveStart = -1;
+            replicaArchiveLength = 0;
             break;
             
-        case 3:
-            printf("Enter new Trip Date (DD/MM/YYYY): ");
-            fgets(trips[index].tripDate, MAX_STRING, stdin);
-            trips[index].tripDate[strcspn(trips[index].tripDate, "\n")] = 0;
+        case 'T':
+            if (fieldCount > 2 && parseIntField(&fields[1], &index) && index >= 0 && index < MAX_TRIPS) {
+                parseTripRecord(fields + 2, fieldCount - 2, &replicaTrips[index]);
+            }
             break;
             
-        case 4:
-            printf("Enter new Departure Time (HH:MM): ");
-            fgets(trips[index].departureTime, MAX_STRING, stdin);
-            trips[index].departureTime[strcspn(trips[index].departureTime, "\n")] = 0;
+        case 'K':
+            if (fieldCount > 2 && parseIntField(&fields[1], &index) && index >= 0 && index < MAX_TICKETS) {
+                parseTicketRecord(fields + 2, fieldCount - 2, &replicaTickets[index]);
+            }
             break;
             
-        case 5:
-            printf("Enter new Bus License Plate: ");
-            fgets(trips[index].busLicensePlate, MAX_STRING, stdin);
-            trips[index].busLicensePlate[strcspn(trips[index].busLicensePlate, "\n")] = 0;
+        case 'P':
+            if (fieldCount > 2 && parseIntField(&fields[1], &index) && index >= 0 && index < MAX_TEMPLATES) {
+                parseTemplateRecord(fields + 2, fieldCount - 2, &replicaTemplates[index]);
+            }
             break;
             
-        case 6:
-            printf("Enter new Driver Name: ");
-            fgets(trips[index].driverName, MAX_STRING, stdin);
-            trips[index].driverName[strcspn(trips[index].driverName, "\n")] = 0;
+        case 'A':
+            // The chunks of a batch follow each other; they are kept until it closes
+            if (fieldCount == 3 && parseLongField(&fields[1], &offset) && fields[2].length % 2 == 0 &&
+                fields[2].length <= REPLICA_ARCHIVE_CHUNK * 2 &&
+                (replicaArchiveStart == -1 || offset == replicaArchiveStart + replicaArchiveLength)) {
+                int size = fields[2].length / 2;
+                if (replicaArchiveLength + size > replicaArchiveCapacity) {
+                    int capacity = replicaArchiveCapacity ? replicaArchiveCapacity : 65536;
+                    while (capacity < replicaArchiveLength + size) capacity *= 2;
+                    unsigned char *grown = realloc(replicaArchive, capacity);
+                    if (grown == NULL) {
+                        printf("\nWarning: Not enough memory for the primary's archive!\n");
+                        return;
+                    }
+                    replicaArchive = grown;
+                    replicaArchiveCapacity = capacity;
+                }
+                
+                unsigned char *chunk = replicaArchive + replicaArchiveLength;
+                for (int i = 0; i < size; i++) {
+                    int high = hexDigitValue(fields[2].start[2 * i]);
+                    int low = hexDigitValue(fields[2].start[2 * i + 1]);
+                    if (high < 0 || low < 0) {
+                        return;
+                    }
+                    chunk[i] = (unsigned char)(high << 4 | low);
+                }
+                if (replicaArchiveStart == -1) {
+                    replicaArchiveStart = offset;
+                }
+                replicaArchiveLength += size;
+            }
             break;
             
-        case 7:
-            printf("Enter new Total Seats: ");
-            int newSeats;
-            scanf("%d", &newSeats);
-            clearInputBuffer();
-            
-            if (newSeats <= 0 || newSeats > MAX_SEATS) {
-                printf("Error: Invalid number of seats!\n");
-                break;
+        case 'C':
+            // Keep exactly the primary's archive and index it again, so
+            // archived trips stay findable and their IDs stay taken
+            archiveSize = stat(ARCHIVE_FILE, &info) == 0 ? info.st_size : 0;
+            if (replicaArchiveStart != -1 || archiveSize != replicaArchiveSize) {
+                if (replicaArchiveStart != -1) {
+                    FILE *file = fopen(ARCHIVE_FILE, "r+b");
+                    if (file == NULL) {
+                        file = fopen(ARCHIVE_FILE, "wb");
+                    }
+                    if (file == NULL || fseek(file, replicaArchiveStart, SEEK_SET) != 0 ||
+                        fwrite(replicaArchive, 1, replicaArchiveLength, file) != (size_t)replicaArchiveLength) {
+                        printf("\nWarning: Could not write %s!\n", ARCHIVE_FILE);
+                    }
+                    if (file != NULL) {
+                        fclose(file);
+                    }
+                }
+                if (replicaArchiveSize == 0) {
+                    remove(ARCHIVE_FILE);
+                } else if (truncate(ARCHIVE_FILE, replicaArchiveSize) != 0) {
+                    printf("\nWarning: Could not write %s!\n", ARCHIVE_FILE);
+                }
+                clearArchiveIndex();
+                refreshArchiveIndex();
+                replicaArchiveStart = -1;
+                replicaArchiveLength = 0;
             }
             
-            // Check if new seat count is less than sold tickets
-            int soldSeats = trips[index].totalSeats - trips[index].availableSeats;
-            if (newSeats < soldSeats) {
-                printf("Error: Cannot reduce seats below %d (already sold tickets)!\n", soldSeats);
-                break;
-            }
+            tripCount = replicaTripCount;
+            ticketCount = replicaTicketCount;
+            templateCount = replicaTemplateCount;
+            memcpy(trips, replicaTrips, sizeof(Trip) * tripCount);
+            memcpy(tickets, replicaTickets, sizeof(Ticket) * ticketCount);
+            memcpy(templates, replicaTemplates, sizeof(TripTemplate) * templateCount);
             
-            // Update available seats proportionally
-            trips[index].availableSeats = newSeats - soldSeats;
-            trips[index].totalSeats = newSeats;
+            // Ticket IDs the primary archived are never handed out again
+            if (replicaLastTicketID > archivedLastTicketID) {
+                archivedLastTicketID = replicaLastTicketID;
+            }
+            rebuildIndexes();
+            saveTripsToFile();
+            saveTicketsToFile();
+            saveTemplatesToFile();
             break;
-            
-        case 8:
-            printf("Enter new Ticket Price: ");
-            float newPrice;
-            scanf("%f", &newPrice);
-            clearInputBuffer();
-            
-            if (newPrice <= 0) {
-                printf("Error: Price must be greater than 0!\n");
+    }
+}
+
+// Take in everything the primary has sent so far without applying it
+// (returns 0 if the connection is gone)
+int receiveChanges() {
+    while (1) {
+        if (replicaInputCapacity - replicaInputLength < REPLICA_READ_SIZE) {
+            size_t capacity = replicaInputCapacity ? replicaInputCapacity * 2 : REPLICA_READ_SIZE * 2;
+            char *grown = realloc(replicaInput, capacity);
+            if (grown == NULL) {
                 break;
             }
-            trips[index].ticketPrice = newPrice;
+            replicaInput = grown;
+            replicaInputCapacity = capacity;
+        }
+        
+        ssize_t received = recv(replicaSocket, replicaInput + replicaInputLength, REPLICA_READ_SIZE, MSG_DONTWAIT);
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 1;
+        }
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
             break;
-            
-        case 0:
-            printf("Exiting.\n");
-            return;
-            
-        default:
-            printf("\n\t[!] Invalid choice!\n");
+        }
+        replicaInputLength += received;
+    }
+    
+    // The primary may still be running: it drops a standby it cannot send to
+    printf("\nWarning: Lost the connection to the primary, will keep trying to reconnect.\n");
+    printf("If the primary has stopped, choose %d to promote this standby.\n", PROMOTE_CHOICE);
+    close(replicaSocket);
+    replicaSocket = -1;
+    return 0;
+}
+
+// Apply every complete line received so far
+void applyReceivedChanges() {
+    char *line = replicaInput;
+    char *end = replicaInput + replicaInputLength;
+    char *newline;
+    while (line != NULL && (newline = memchr(line, '\n', end - line)) != NULL) {
+        applyReplicaLine(line, newline);
+        line = newline + 1;
+    }
+    
+    // Keep the unfinished line for later
+    if (line != NULL) {
+        replicaInputLength = end - line;
+        memmove(replicaInput, line, replicaInputLength);
+    }
+}
+
+// Read the keyboard. Meanwhile a standby keeps taking in the primary's
+// changes, so an operator busy inside a menu never holds up the primary;
+// they are applied at the next menu prompt.
+ssize_t keyboardRead(void *cookie, char *buffer, size_t size) {
+    (void)cookie;
+    while (replicaRole == REPLICA_STANDBY && replicaSocket != -1) {
+        struct pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {replicaSocket, POLLIN, 0}};
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[0].revents != 0) {
             break;
         }
+        if (fds[1].revents != 0) {
+            receiveChanges();
+        }
     }
-    
-    // Save changes to file
-    saveTripsToFile();
-    
-    printf("\n✓ Trip updated successfully!\n");
+    return read(STDIN_FILENO, buffer, size);
 }
 
-// Delete a trip
-void deleteTrip() {
-    printf("\n========================================\n");
-    printf("           DELETE TRIP\n");
-    printf("========================================\n");
-    
-    int tripID;
-    printf("Enter Trip ID to delete: ");
-    scanf("%d", &tripID);
-    clearInputBuffer();
-    
-    // Find the trip
-    int index = findTripByID(tripID);
-    if (index == -1) {
-        printf("Error: Trip with ID %d not found!\n", tripID);
+// Wait for the next menu choice. Meanwhile the primary takes in a standby
+// and ships the shared store's changes, and a standby applies the
+// primary's changes and reconnects if needed.
+void waitForInput() {
+    if (replicaRole == REPLICA_NONE) {
         return;
     }
+    if (replicaRole == REPLICA_STANDBY) {
+        applyReceivedChanges();
+    }
+    fflush(stdout);
     
-    // Display trip information
-    printf("\n--- Trip Information ---\n");
-    printf("Trip ID: %d\n", trips[index].tripID);
-    printf("Route: %s -> %s\n", trips[index].departurePoint, trips[index].arrivalPoint);
-    printf("Date: %s at %s\n", trips[index].tripDate, trips[index].departureTime);
-    printf("Driver: %s\n", trips[index].driverName);
-    printf("Available Seats: %d/%d\n", trips[index].availableSeats, trips[index].totalSeats);
-    
-    // Check if there are sold tickets for this trip
-    int soldTickets = trips[index].totalSeats - trips[index].availableSeats;
-    if (soldTickets > 0) {
-        printf("\nWarning: This trip has %d sold ticket(s)!\n", soldTickets);
-        printf("Deleting this trip will also cancel all related tickets.\n");
+    while (1) {
+        struct pollfd fds[2];
+        int count = 0;
+        fds[count].fd = STDIN_FILENO;
+        fds[count++].events = POLLIN;
+        if (replicaSocket != -1) {
+            fds[count].fd = replicaSocket;
+            fds[count++].events = POLLIN;
+        } else if (replicaListener != -1) {
+            fds[count].fd = replicaListener;
+            fds[count++].events = POLLIN;
+        }
+        
+        int ready = poll(fds, count, REPLICA_RETRY_MS);
+        if (ready < 0 && errno != EINTR) {
+            return;
+        }
+        if (ready > 0 && fds[0].revents != 0) {
+            return;
+        }
+        
+        if (ready > 0 && count > 1 && fds[1].revents != 0) {
+            if (replicaRole == REPLICA_STANDBY) {
+                if (!receiveChanges()) {
+                    printf("Enter your choice: ");
+                    fflush(stdout);
+                }
+                applyReceivedChanges();
+            } else if (replicaSocket != -1) {
+                // The standby never writes, so this is it going away
+                printf("\nWarning: Lost the standby.\n");
+                printf("Enter your choice: ");
+                fflush(stdout);
+                close(replicaSocket);
+                replicaSocket = -1;
+            } else {
+                replicaSocket = accept(replicaListener, NULL, NULL);
+                if (replicaSocket != -1 && !isSameUserPeer(replicaSocket)) {
+                    printf("\nWarning: Refused a standby run by another user.\n");
+                    printf("Enter your choice: ");
+                    fflush(stdout);
+                    close(replicaSocket);
+                    replicaSocket = -1;
+                } else if (replicaSocket != -1) {
+                    struct timeval timeout = {REPLICA_SEND_TIMEOUT, 0};
+                    setsockopt(replicaSocket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+                    shipChanges(1);
+                }
+            }
+        } else if (ready == 0 && replicaRole == REPLICA_PRIMARY && replicaSocket != -1 && sharedStore != NULL) {
+            // Sales at the other counters reach the standby without waiting for this one
+            unsigned long before = sharedVersion;
+            syncSharedStore();
+            if (sharedVersion != before) {
+                shipChanges(0);
+            }
+        } else if (ready == 0 && replicaRole == REPLICA_STANDBY && replicaSocket == -1) {
+            replicaSocket = connectToPrimary();
+            if (replicaSocket != -1) {
+                printf("Enter your choice: ");
+                fflush(stdout);
+            }
+        }
+    }
+}
+
+// Menu choices a standby serves: inquiries, listings, reports and promotion
+int isStandbyChoice(int choice) {
+    return choice == 0 || choice == 4 || choice == 5 || choice == 10 || choice == 11 ||
+           choice == 12 || choice == 13 || choice == 16 || choice == PROMOTE_CHOICE;
+}
+
+// Take over from a primary that has stopped
+void promoteStandby() {
+    if (replicaSocket != -1) {
+        printf("Error: The primary is still running! Stop it before promoting this standby.\n");
+        return;
     }
     
-    // Confirmation
-    char confirm;
-    printf("\nAre you sure you want to delete this trip? (Y/N): ");
-    scanf(" %c", &confirm);
-    clearInputBuffer();
+    // Its data is already in memory and on file; a new standby can follow it
+    if (!startPrimary(replicaPath)) {
+        return;
+    }
+    printf("\n✓ This counter is now the primary.\n");
+}
+
+// Hash the next LZ_MIN_MATCH bytes
+unsigned int lzHash(const unsigned char *p) {
+    unsigned int bytes = (unsigned int)p[0] | (unsigned int)p[1] << 8 | (unsigned int)p[2] << 16 | (unsigned int)p[3] << 24;
+    return (bytes * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// Emit literal bytes in runs of up to LZ_MAX_LITERALS (returns bytes written)
+int lzWriteLiterals(const unsigned char *literals, int count, unsigned char *out) {
+    int written = 0;
+    while (count > 0) {
+        int run = count < LZ_MAX_LITERALS ? count : LZ_MAX_LITERALS;
+        out[written++] = (unsigned char)(run - 1);
+        memcpy(out + written, literals, run);
+        written += run;
+        literals += run;
+        count -= run;
+    }
+    return written;
+}
+
+// Compress with a small LZ77 scheme (returns the compressed size; out
+// needs size + size / LZ_MAX_LITERALS + 1 bytes). Tokens below 0x80 are
+// followed by that many plus one literal bytes; 0x80 and up copy
+// (token & 0x7F) + LZ_MIN_MATCH bytes from the 16-bit distance that follows.
+int lzCompress(const unsigned char *in, int size, unsigned char *out) {
+    int head[1 << LZ_HASH_BITS];
+    for (int i = 0; i < (1 << LZ_HASH_BITS); i++) head[i] = -1;
     
-    if (confirm == 'Y' || confirm == 'y') {
-        // Mark trip as inactive (soft delete)
-        trips[index].isActive = 0;
+    int outSize = 0;
+    int literalStart = 0;
+    int pos = 0;
+    while (pos + LZ_MIN_MATCH <= size) {
+        unsigned int hash = lzHash(in + pos);
+        int candidate = head[hash];
+        head[hash] = pos;
         
-        // Cancel all tickets for this trip
-        int cancelledCount = 0;
-        for (int i = 0; i < ticketCount; i++) {
-            if (tickets[i].tripID == tripID && tickets[i].isActive == 1) {
-                tickets[i].isActive = 0;
-                cancelledCount++;
+        int length = 0;
+        if (candidate != -1 && pos - candidate <= LZ_WINDOW) {
+            while (length < LZ_MAX_MATCH && pos + length < size && in[candidate + length] == in[pos + length]) {
+                length++;
             }
         }
+        if (length < LZ_MIN_MATCH) {
+            pos++;
+            continue;
+        }
         
-        // Save changes
-        saveTripsToFile();
-        saveTicketsToFile();
+        outSize += lzWriteLiterals(in + literalStart, pos - literalStart, out + outSize);
+        int distance = pos - candidate;
+        out[outSize++] = (unsigned char)(0x80 | (length - LZ_MIN_MATCH));
+        out[outSize++] = (unsigned char)(distance & 0xFF);
+        out[outSize++] = (unsigned char)(distance >> 8);
         
-        printf("\n✓ Trip deleted successfully!\n");
-        if (cancelledCount > 0) {
-            printf("✓ %d ticket(s) have been cancelled.\n", cancelledCount);
+        // Remember the matched positions too, records repeat field by field
+        for (int k = 1; k < length && pos + k + LZ_MIN_MATCH <= size; k++) {
+            head[lzHash(in + pos + k)] = pos + k;
         }
-    } else {
-        printf("\nDeletion cancelled.\n");
+        pos += length;
+        literalStart = pos;
     }
+    
+    outSize += lzWriteLiterals(in + literalStart, size - literalStart, out + outSize);
+    return outSize;
 }
 
-// Inquire trip details
-void inquireTrip() {
-    printf("\n========================================\n");
-    printf("         TRIP INQUIRY\n");
-    printf("========================================\n");
-    
-    int tripID;
-    printf("Enter Trip ID to inquire: ");
-    scanf("%d", &tripID);
-    clearInputBuffer();
-    
-    // Find the trip
-    int index = findTripByID(tripID);
-    if (index == -1) {
-        printf("Error: Trip with ID %d not found!\n", tripID);
+// Expand lzCompress output (returns the expanded size, -1 if it is damaged)
+int lzDecompress(const unsigned char *in, int size, unsigned char *out, int capacity) {
+    int i = 0;
+    int produced = 0;
+    while (i < size) {
+        int token = in[i++];
+        if (token < 0x80) {
+            int count = token + 1;
+            if (i + count > size || produced + count > capacity) {
+                return -1;
+            }
+            memcpy(out + produced, in + i, count);
+            i += count;
+            produced += count;
+        } else {
+            int length = (token & 0x7F) + LZ_MIN_MATCH;
+            if (i + 2 > size) {
+                return -1;
+            }
+            int distance = in[i] | in[i + 1] << 8;
+            i += 2;
+            if (distance == 0 || distance > produced || produced + length > capacity) {
+                return -1;
+            }
+            
+            // Byte by byte, a match may overlap the bytes it produces
+            for (int k = 0; k < length; k++) {
+                out[produced + k] = out[produced - distance + k];
+            }
+            produced += length;
+        }
+    }
+    return produced;
+}
+
+// Empty the archive index
+void clearArchiveIndex() {
+    archiveIndexCount = 0;
+    archiveIndexedSize = 0;
+    archivedLastTicketID = 0;
+    for (int i = 0; i < ARCHIVE_HASH_SIZE; i++) archiveHashHead[i] = -1;
+}
+
+// Index archive blocks written since the last call. A block cut short by
+// a crash ends the index and is overwritten by the next archive run.
+void refreshArchiveIndex() {
+    struct stat info;
+    if (stat(ARCHIVE_FILE, &info) != 0) {
+        // No archive yet
+        clearArchiveIndex();
         return;
     }
+    if (info.st_size == archiveIndexedSize) {
+        return;
+    }
+    if (info.st_size < archiveIndexedSize) {
+        // The archive was replaced, start over
+        clearArchiveIndex();
+    }
     
-    // Display detailed trip information
-    printf("\n========================================\n");
-    printf("       TRIP DETAILS - ID: %d\n", trips[index].tripID);
-    printf("========================================\n\n");
-    
-    printf("Route Information:\n");
-    printf("  Departure Point : %s\n", trips[index].departurePoint);
-    printf("  Arrival Point   : %s\n", trips[index].arrivalPoint);
-    printf("  Trip Date       : %s\n", trips[index].tripDate);
-    printf("  Departure Time  : %s\n", trips[index].departureTime);
-    
-    printf("\nBus Information:\n");
-    printf("  License Plate   : %s\n", trips[index].busLicensePlate);
-    printf("  Driver Name     : %s\n", trips[index].driverName);
-    
-    printf("\nSeat Information:\n");
-    printf("  Total Seats     : %d\n", trips[index].totalSeats);
-    printf("  Available Seats : %d\n", trips[index].availableSeats);
-    printf("  Sold Seats      : %d\n", trips[index].totalSeats - trips[index].availableSeats);
-    printf("  Occupancy Rate  : %.1f%%\n", 
-           ((float)(trips[index].totalSeats - trips[index].availableSeats) / trips[index].totalSeats) * 100);
-    
-    printf("\nPricing Information:\n");
-    printf("  Ticket Price    : %.2f TL\n", trips[index].ticketPrice);
+    FILE *file = fopen(ARCHIVE_FILE, "rb");
+    if (file == NULL || fseek(file, archiveIndexedSize, SEEK_SET) != 0) {
+        if (file != NULL) fclose(file);
+        return;
+    }
     
-    // Show passengers list if there are sold tickets
-    int soldSeats = trips[index].totalSeats - trips[index].availableSeats;
-    if (soldSeats > 0) {
-        printf("\nPassenger List:\n");
-        printf("  %-5s %-25s %-15s %-15s\n", "Seat", "Passenger Name", "ID Number", "Phone");
-        printf("  %s\n", "------------------------------------------------------------------------");
+    long offset = archiveIndexedSize;
+    ArchiveBlockHeader header;
+    while (fread(&header, sizeof(header), 1, file) == 1) {
+        long end = offset + (long)sizeof(header) + (long)header.tripCount * (long)sizeof(int) + header.compressedSize;
+        if (header.magic != ARCHIVE_MAGIC || header.tripCount < 0 || header.compressedSize < 0 ||
+            header.rawSize < 0 || end > info.st_size) {
+            break;
+        }
         
-        int passengerCount = 0;
-        for (int i = 0; i < ticketCount; i++) {
-            if (tickets[i].tripID == tripID && tickets[i].isActive == 1) {
-                printf("  %-5d %-25s %-15s %-15s\n", 
-                       tickets[i].seatNumber,
-                       tickets[i].passenger.fullName,
-                       tickets[i].passenger.idNumber,
-                       tickets[i].passenger.phoneNumber);
-                passengerCount++;
+        if (archiveIndexCount + header.tripCount > archiveIndexCapacity) {
+            int capacity = archiveIndexCapacity ? archiveIndexCapacity : 64;
+            while (capacity < archiveIndexCount + header.tripCount) capacity *= 2;
+            ArchiveEntry *grown = realloc(archiveIndex, sizeof(ArchiveEntry) * capacity);
+            if (grown == NULL) {
+                printf("Error: Not enough memory to index the archive!\n");
+                break;
             }
+            archiveIndex = grown;
+            archiveIndexCapacity = capacity;
         }
-        printf("  %s\n", "------------------------------------------------------------------------");
-        printf("  Total Passengers: %d\n", passengerCount);
-    } else {
-        printf("\n  No tickets sold for this trip yet.\n");
+        
+        int complete = 1;
+        for (int i = 0; i < header.tripCount && complete; i++) {
+            complete = fread(&archiveIndex[archiveIndexCount + i].tripID, sizeof(int), 1, file) == 1;
+            archiveIndex[archiveIndexCount + i].offset = offset;
+        }
+        if (!complete || fseek(file, header.compressedSize, SEEK_CUR) != 0) {
+            break;
+        }
+        
+        // Hash the block's entries only once it is known to be whole
+        for (int i = 0; i < header.tripCount; i++) {
+            ArchiveEntry *entry = &archiveIndex[archiveIndexCount + i];
+            unsigned int bucket = hashID(entry->tripID, ARCHIVE_HASH_SIZE);
+            entry->next = archiveHashHead[bucket];
+            archiveHashHead[bucket] = archiveIndexCount + i;
+        }
+        archiveIndexCount += header.tripCount;
+        if (header.lastTicketID > archivedLastTicketID) {
+            archivedLastTicketID = header.lastTicketID;
+        }
+        offset = end;
     }
     
-    printf("\n========================================\n");
+    archiveIndexedSize = offset;
+    fclose(file);
 }
 
-// List all trips
-void listAllTrips() {
+// Read and expand one archive block (returns its NUL terminated lines,
+// which the caller frees, or NULL if the block is damaged)
+char *readArchiveBlock(long offset, ArchiveBlockHeader *header) {
+    FILE *file = fopen(ARCHIVE_FILE, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    
+    char *raw = NULL;
+    unsigned char *compressed = NULL;
+    if (fseek(file, offset, SEEK_SET) == 0 && fread(header, sizeof(*header), 1, file) == 1 &&
+        header->magic == ARCHIVE_MAGIC &&
+        fseek(file, (long)header->tripCount * (long)sizeof(int), SEEK_CUR) == 0) {
+        compressed = malloc(header->compressedSize > 0 ? header->compressedSize : 1);
+        raw = malloc(header->rawSize + 1);
+        if (compressed == NULL || raw == NULL ||
+            fread(compressed, 1, header->compressedSize, file) != (size_t)header->compressedSize ||
+            lzDecompress(compressed, header->compressedSize, (unsigned char *)raw, header->rawSize) != header->rawSize) {
+            free(raw);
+            raw = NULL;
+        } else {
+            raw[header->rawSize] = '\0';
+        }
+    }
+    
+    free(compressed);
+    fclose(file);
+    return raw;
+}
+
+// Compress one block of archive lines and append it (returns 0 on a write error)
+int appendArchiveBlock(FILE *file, const char *raw, int rawSize, const int *tripIDs, int tripCount,
+                       int ticketCount, long *compressedTotal) {
+    unsigned char *compressed = malloc(rawSize + rawSize / LZ_MAX_LITERALS + 1);
+    if (compressed == NULL) {
+        return 0;
+    }
+    
+    ArchiveBlockHeader header;
+    header.magic = ARCHIVE_MAGIC;
+    header.tripCount = tripCount;
+    header.ticketCount = ticketCount;
+    header.rawSize = rawSize;
+    header.compressedSize = lzCompress((const unsigned char *)raw, rawSize, compressed);
+    header.lastTicketID = lastTicketID;
+    
+    int written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  fwrite(tripIDs, sizeof(int), tripCount, file) == (size_t)tripCount &&
+                  fwrite(compressed, 1, header.compressedSize, file) == (size_t)header.compressedSize;
+    *compressedTotal += (long)sizeof(header) + (long)tripCount * (long)sizeof(int) + header.compressedSize;
+    free(compressed);
+    return written;
+}
+
+// Move trips whose date has passed, with all their tickets, to the archive
+void archiveDepartedTrips() {
     printf("\n========================================\n");
-    printf("         ALL TRIPS LIST\n");
+    printf("       ARCHIVE DEPARTED TRIPS\n");
     printf("========================================\n");
     
-    // Count active trips
-    int activeTrips = 0;
-    for (int i = 0; i < tripCount; i++) {
-        if (trips[i].isActive == 1) {
-            activeTrips++;
+    int today = getCurrentDay();
+    
+    // Trip indexes move, so no other counter may be working from them
+    beginSharedUpdate();
+    if (sharedStore != NULL) {
+        for (int i = 0; i < MAX_COUNTERS; i++) {
+            if (i != counterSlot && sharedStore->counterPid[i] != 0 && isCounterAlive(sharedStore->counterPid[i])) {
+                printf("Error: Close the other counters before archiving!\n");
+                endSharedUpdate(0);
+                return;
+            }
         }
     }
     
-    // Check if there are any trips
-    if (activeTrips == 0) {
-        printf("\nNo trips found in the system.\n");
+    // Departed trips, deleted or not
+    char departed[MAX_TRIPS];
+    int departedCount = 0;
+    for (int i = 0; i < tripCount; i++) {
+        int day;
+        departed[i] = parseDate(trips[i].tripDate, &day) && day < today;
+        departedCount += departed[i];
+    }
+    if (departedCount == 0) {
+        printf("No departed trips to archive.\n");
+        endSharedUpdate(0);
         return;
     }
     
-    printf("\nTotal Active Trips: %d\n\n", activeTrips);
+    // Tickets go with their departed trip, unless a kept trip has the same ID
+    int ticketOwner[MAX_TICKETS];
+    int archivedTickets = 0;
+    for (int i = 0; i < ticketCount; i++) {
+        ticketOwner[i] = -1;
+        for (int j = 0; j < tripCount; j++) {
+            if (trips[j].tripID != tickets[i].tripID) {
+                continue;
+            }
+            if (!departed[j]) {
+                ticketOwner[i] = -1;
+                break;
+            }
+            if (ticketOwner[i] == -1) {
+                ticketOwner[i] = j;
+            }
+        }
+        archivedTickets += ticketOwner[i] != -1;
+    }
     
-    // Table header
-    printf("%-6s %-15s %-15s %-12s %-8s %-10s %-5s %-10s\n",
-           "ID", "From", "To", "Date", "Time", "Price", "Seats", "Status");
-    printf("%-6s %-15s %-15s %-12s %-8s %-10s %-5s %-10s\n",
-           "------", "---------------", "---------------", "------------", 
-           "--------", "----------", "-----", "----------");
+    // Drop any stale (partial) block left by a crash, then append
+    refreshArchiveIndex();
+    struct stat info;
+    if (stat(ARCHIVE_FILE, &info) == 0 && info.st_size > archiveIndexedSize &&
+        truncate(ARCHIVE_FILE, archiveIndexedSize) != 0) {
+        printf("Error: Could not repair the archive file!\n");
+        endSharedUpdate(0);
+        return;
+    }
+    FILE *file = fopen(ARCHIVE_FILE, "ab");
+    if (file == NULL) {
+        printf("Error: Could not open archive file for writing!\n");
+        endSharedUpdate(0);
+        return;
+    }
     
-    // Display all active trips
-    for (int i = 0; i < tripCount; i++) {
-        if (trips[i].isActive == 1) {
-            // Calculate status
-            char status[20];
-            int soldSeats = trips[i].totalSeats - trips[i].availableSeats;
-            float occupancy = ((float)soldSeats / trips[i].totalSeats) * 100;
-            
-            if (trips[i].availableSeats == 0) {strcpy(status, "FULL");
-            } else if (occupancy >= 80) {strcpy(status, "Almost Full");
-            } else if (occupancy >= 50) {strcpy(status, "Half Full");
-            } else {strcpy(status, "Available");
+    // Gather whole trips into blocks of about ARCHIVE_BLOCK_SIZE bytes
+    long rawTotal = 0;
+    long compressedTotal = 0;
+    int written = 1;
+    int blockTrips[MAX_TRIPS];
+    int blockTripCount = 0;
+    int blockTicketCount = 0;
+    char *raw = NULL;
+    size_t rawSize = 0;
+    FILE *block = open_memstream(&raw, &rawSize);
+    
+    for (int i = 0; i < tripCount && written && block != NULL; i++) {
+        if (!departed[i]) {
+            continue;
+        }
+        
+        fputs("T|", block);
+        writeTripRecord(block, &trips[i]);
+        for (int k = 0; k < ticketCount; k++) {
+            if (ticketOwner[k] == i) {
+                fputs("K|", block);
+                writeTicketRecord(block, &tickets[k]);
+                blockTicketCount++;
+            }
+        }
+        blockTrips[blockTripCount++] = trips[i].tripID;
+        fflush(block);
+        
+        if (rawSize >= ARCHIVE_BLOCK_SIZE) {
+            written = appendArchiveBlock(file, raw, (int)rawSize, blockTrips, blockTripCount, blockTicketCount,
+                                         &compressedTotal);
+            rawTotal += (long)rawSize;
+            fclose(block);
+            free(raw);
+            raw = NULL;
+            rawSize = 0;
+            block = open_memstream(&raw, &rawSize);
+            blockTripCount = 0;
+            blockTicketCount = 0;
+        }
+    }
+    if (block == NULL) {
+        written = 0;
+    } else {
+        fflush(block);
+        if (written && blockTripCount > 0) {
+            written = appendArchiveBlock(file, raw, (int)rawSize, blockTrips, blockTripCount, blockTicketCount,
+                                         &compressedTotal);
+            rawTotal += (long)rawSize;
+        }
+        fclose(block);
+    }
+    free(raw);
+    if (fclose(file) != 0) {
+        written = 0;
+    }
+    if (!written) {
+        printf("Error: Could not write the archive! Nothing was removed.\n");
+        endSharedUpdate(0);
+        return;
+    }
+    refreshArchiveIndex();
+    
+    // Waitlists and holds of archived trips end here
+    for (int i = 0; i < tripCount; i++) {
+        if (!departed[i]) {
+            continue;
+        }
+        clearWaitlist(i);
+        for (int h = 0; heldMap[i] != 0 && h < holdCount; h++) {
+            if (holds[h].isActive && holds[h].tripIndex == i) {
+                releaseHold(h);
             }
-            
-            // Truncate long city names for table format
-            char fromCity[16], toCity[16];
-            strncpy(fromCity, trips[i].departurePoint, 15);
-            fromCity[15] = '\0';
-            strncpy(toCity, trips[i].arrivalPoint, 15);
-            toCity[15] = '\0';
-            
-            printf("%-6d %-15s %-15s %-12s %-8s %-10.2f %d/%-3d %-10s\n",
-                   trips[i].tripID,
-                   fromCity,
-                   toCity,
-                   trips[i].tripDate,
-                   trips[i].departureTime,
-                   trips[i].ticketPrice,
-                   trips[i].availableSeats,
-                   trips[i].totalSeats,
-                   status);
         }
     }
     
-    printf("\n========================================\n");
+    // Compact the live arrays, moving this counter's per-trip state along
+    int newIndex[MAX_TRIPS];
+    int head[MAX_TRIPS], tail[MAX_TRIPS], length[MAX_TRIPS];
+    int keptTrips = 0;
+    for (int i = 0; i < tripCount; i++) {
+        newIndex[i] = -1;
+        if (departed[i]) {
+            continue;
+        }
+        newIndex[i] = keptTrips;
+        trips[keptTrips] = trips[i];
+        head[keptTrips] = waitlistHead[i];
+        tail[keptTrips] = waitlistTail[i];
+        length[keptTrips] = waitlistLength[i];
+        heldMap[keptTrips] = heldMap[i];
+        keptTrips++;
+    }
+    for (int i = keptTrips; i < tripCount; i++) {
+        heldMap[i] = 0;
+    }
+    for (int h = 0; h < holdCount; h++) {
+        if (holds[h].isActive) {
+            holds[h].tripIndex = newIndex[holds[h].tripIndex];
+        }
+    }
+    for (int i = 0; i < tripCount; i++) {
+        publishHeldSeats(i);
+    }
     
-    // Summary statistics
-    int totalSeats = 0;
-    int totalAvailable = 0;
-    float totalRevenue = 0;
+    int keptTickets = 0;
+    for (int i = 0; i < ticketCount; i++) {
+        if (ticketOwner[i] == -1) {
+            tickets[keptTickets++] = tickets[i];
+        }
+    }
     
-    for (int i = 0; i < tripCount; i++) {
-        if (trips[i].isActive == 1) {
-            totalSeats += trips[i].totalSeats;
-            totalAvailable += trips[i].availableSeats;
-            
-            // Calculate revenue from sold tickets
-            int soldSeats = trips[i].totalSeats - trips[i].availableSeats;
-            totalRevenue += soldSeats * trips[i].ticketPrice;
+    tripCount = keptTrips;
+    ticketCount = keptTickets;
+    rebuildIndexes();
+    memcpy(waitlistHead, head, sizeof(int) * tripCount);
+    memcpy(waitlistTail, tail, sizeof(int) * tripCount);
+    memcpy(waitlistLength, length, sizeof(int) * tripCount);
+    
+    saveTripsToFile();
+    saveTicketsToFile();
+    saveWaitlistToFile();
+    endSharedUpdate(1);
+    
+    printf("\n✓ Archived %d trip(s) and %d ticket(s).\n", departedCount, archivedTickets);
+    printf("Archive size: %ld bytes (%ld bytes before compression)\n", compressedTotal, rawTotal);
+    printf("Trips still on file: %d, tickets: %d\n", tripCount, ticketCount);
+}
+
+// Check whether a trip ID is in the archive, so it is never handed out again
+int isArchivedTrip(int tripID) {
+    refreshArchiveIndex();
+    for (int e = archiveHashHead[hashID(tripID, ARCHIVE_HASH_SIZE)]; e != -1; e = archiveIndex[e].next) {
+        if (archiveIndex[e].tripID == tripID) {
+            return 1;
         }
     }
+    return 0;
+}
+
+// Show an archived trip and its passengers (returns 0 if it is not archived)
+int showArchivedTrip(int tripID) {
+    refreshArchiveIndex();
     
-    printf("\nSummary:\n");
-    printf("  Total Capacity    : %d seats\n", totalSeats);
-    printf("  Available Seats   : %d seats\n", totalAvailable);
-    printf("  Sold Seats        : %d seats\n", totalSeats - totalAvailable);
-    printf("  Overall Occupancy : %.1f%%\n", 
-           totalSeats > 0 ? ((float)(totalSeats - totalAvailable) / totalSeats) * 100 : 0);
-    printf("  Total Revenue     : %.2f TL\n", totalRevenue);
-    printf("\n========================================\n");
+    // Newest copy first, a trip archived twice keeps its latest state
+    for (int e = archiveHashHead[hashID(tripID, ARCHIVE_HASH_SIZE)]; e != -1; e = archiveIndex[e].next) {
+        if (archiveIndex[e].tripID != tripID) {
+            continue;
+        }
+        
+        ArchiveBlockHeader header;
+        char *raw = readArchiveBlock(archiveIndex[e].offset, &header);
+        if (raw == NULL) {
+            printf("Warning: Archive block at byte %ld is damaged!\n", archiveIndex[e].offset);
+            continue;
+        }
+        
+        // Find the trip line
+        const char *end = raw + header.rawSize;
+        const char *p = raw;
+        Field fields[MAX_FIELDS];
+        Trip trip;
+        int found = 0;
+        while (p < end && !found) {
+            int fieldCount = splitFields(&p, end, fields);
+            if (fields[0].length == 1 && fields[0].start[0] == 'T' &&
+                parseTripRecord(fields + 1, fieldCount - 1, &trip) > 0 && trip.tripID == tripID) {
+                found = 1;
+            }
+        }
+        if (!found) {
+            free(raw);
+            continue;
+        }
+        
+        printf("\n========================================\n");
+        printf("   ARCHIVED TRIP DETAILS - ID: %d\n", trip.tripID);
+        printf("========================================\n\n");
+        if (trip.isActive != 1) {
+            printf("This trip was deleted before it departed.\n\n");
+        }
+        
+        printf("Route Information:\n");
+        printf("  Departure Point : %s\n", trip.departurePoint);
+        printf("  Arrival Point   : %s\n", trip.arrivalPoint);
+        if (trip.stops[0]) {
+            printf("  Stops           : %s\n", trip.stops);
+        }
+        printf("  Trip Date       : %s\n", trip.tripDate);
+        printf("  Departure Time  : %s\n", trip.departureTime);
+        if (trip.arrivalTime[0]) {
+            printf("  Arrival Time    : %s\n", trip.arrivalTime);
+        }
+        
+        printf("\nBus Information:\n");
+        printf("  License Plate   : %s\n", trip.busLicensePlate);
+        printf("  Driver Name     : %s\n", trip.driverName);
+        printf("  Total Seats     : %d\n", trip.totalSeats);
+        printf("  Ticket Price    : %.2f TL\n", trip.ticketPrice);
+        
+        // Passengers who travelled
+        printf("\nPassenger List:\n");
+        printf("  %-5s %-25s %-15s %-15s\n", "Seat", "Passenger Name", "ID Number", "Phone");
+        printf("  %s\n", "------------------------------------------------------------------------");
+        int passengerCount = 0;
+        for (p = raw; p < end;) {
+            Ticket ticket;
+            int fieldCount = splitFields(&p, end, fields);
+            if (fields[0].length == 1 && fields[0].start[0] == 'K' &&
+                parseTicketRecord(fields + 1, fieldCount - 1, &ticket) > 0 &&
+                ticket.tripID == tripID && ticket.isActive == 1) {
+                printf("  %-5d %-25s %-15s %-15s\n", ticket.seatNumber, ticket.passenger.fullName,
+                       ticket.passenger.idNumber, ticket.passenger.phoneNumber);
+                passengerCount++;
+            }
+        }
+        printf("  %s\n", "------------------------------------------------------------------------");
+        printf("  Total Passengers: %d\n", passengerCount);
+        printf("\n========================================\n");
+        
+        free(raw);
+        return 1;
+    }
+    return 0;
 }
 
-// Sell a ticket
-void sellTicket() {
+// Order boarding entries by ticket ID
+int compareBoardingEntries(const void *a, const void *b) {
+    int left = ((const BoardingEntry *)a)->ticketID;
+    int right = ((const BoardingEntry *)b)->ticketID;
+    return (left > right) - (left < right);
+}
+
+// Binary search the boarding table (returns entry position, -1 if not there)
+int findBoardingEntry(const BoardingEntry *entries, int count, int ticketID) {
+    int low = 0;
+    int high = count;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (entries[middle].ticketID < ticketID) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < count && entries[low].ticketID == ticketID ? low : -1;
+}
+
+// Validate scanned ticket numbers at the gate for one trip
+void boardTrip() {
     printf("\n========================================\n");
-    printf("           SELL TICKET\n");
+    printf("           BOARDING MODE\n");
     printf("========================================\n");
     
-    // Check if we have space for more tickets
-    if (ticketCount >= MAX_TICKETS) {
-        printf("Error: Maximum ticket limit reached!\n");
-        return;
-    }
-    
     int tripID;
     printf("Enter Trip ID: ");
     scanf("%d", &tripID);
@@ -792,128 +7121,478 @@ void sellTicket() {
         return;
     }
     
-    // Check if seats are available
-    if (trips[tripIndex].availableSeats <= 0) {
-        printf("Error: No available seats for this trip!\n");
-        return;
+    // Preload the trip's valid tickets into a sorted table
+    BoardingEntry entries[MAX_TICKETS];
+    char boarded[MAX_TICKETS]; // 1 if boarded before, 2 if in this session; written back at the end
+    int count = 0;
+    for (int i = tripFirstTicket[tripIndex]; i != -1; i = ticketNextInTrip[i]) {
+        entries[count].ticketID = tickets[i].ticketID;
+        entries[count].ticketIndex = i;
+        count++;
+    }
+    qsort(entries, count, sizeof(BoardingEntry), compareBoardingEntries);
+    int alreadyBoarded = 0;
+    for (int i = 0; i < count; i++) {
+        boarded[i] = (char)tickets[entries[i].ticketIndex].boarded;
+        alreadyBoarded += boarded[i];
     }
     
-    // Display trip information
-    printf("\n--- Trip Information ---\n");
-    printf("Route: %s -> %s\n", trips[tripIndex].departurePoint, trips[tripIndex].arrivalPoint);
-    printf("Date: %s at %s\n", trips[tripIndex].tripDate, trips[tripIndex].departureTime);
-    printf("Available Seats: %d/%d\n", trips[tripIndex].availableSeats, trips[tripIndex].totalSeats);
-    printf("Price: %.2f TL\n", trips[tripIndex].ticketPrice);
+    printf("\nTrip %d: %s -> %s, %s at %s\n", tripID, trips[tripIndex].departurePoint,
+           trips[tripIndex].arrivalPoint, trips[tripIndex].tripDate, trips[tripIndex].departureTime);
+    printf("%d valid ticket(s), %d already boarded.\n", count, alreadyBoarded);
+    printf("Scan ticket numbers, one per line (empty line or 0 to finish):\n");
     
-    // Show occupied seats
-    printf("\nOccupied Seats: ");
-    int hasOccupied = 0;
-    for (int i = 0; i < ticketCount; i++) {
-        if (tickets[i].tripID == tripID && tickets[i].isActive == 1) {
-            printf("%d ", tickets[i].seatNumber);
-            hasOccupied = 1;
+    int scanned = 0, accepted = 0, duplicates = 0, rejected = 0, lookups = 0, cancelled = 0;
+    double lookupSeconds = 0;
+    char line[MAX_STRING];
+    while (fgets(line, sizeof(line), stdin) != NULL) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0] == '\0') {
+            break;
+        }
+        
+        // Barcodes carry the ticket ID as 10 digits
+        char *rest;
+        long number = strtol(line, &rest, 10);
+        if (rest == line || *rest != '\0' || number < 0 || number > 2147483647L) {
+            printf("  %-12s REJECTED  not a ticket number\n", line);
+            rejected++;
+            scanned++;
+            continue;
+        }
+        if (number == 0) {
+            break;
+        }
+        scanned++;
+        
+        struct timespec started, finished;
+        clock_gettime(CLOCK_MONOTONIC, &started);
+        int entry = findBoardingEntry(entries, count, (int)number);
+        clock_gettime(CLOCK_MONOTONIC, &finished);
+        lookups++;
+        lookupSeconds += (finished.tv_sec - started.tv_sec) + (finished.tv_nsec - started.tv_nsec) / 1e9;
+        
+        if (entry == -1) {
+            // Tell a ticket for another bus apart from an invalid one
+            int other = findTicketByID((int)number);
+            if (other != -1) {
+                printf("  %-12ld REJECTED  ticket is for Trip ID %d\n", number, tickets[other].tripID);
+            } else {
+                printf("  %-12ld REJECTED  no valid ticket with this number\n", number);
+            }
+            rejected++;
+        } else if (boarded[entry]) {
+            printf("  %-12ld DUPLICATE seat %d already boarded\n", number,
+                   tickets[entries[entry].ticketIndex].seatNumber);
+            duplicates++;
+        } else {
+            Ticket *ticket = &tickets[entries[entry].ticketIndex];
+            printf("  %-12ld OK        seat %-3d %s\n", number, ticket->seatNumber, ticket->passenger.fullName);
+            boarded[entry] = 2;
+            accepted++;
         }
     }
-    if (!hasOccupied) {
-        printf("None (All seats available)");
-    }
-    printf("\n\n");
     
-    // Create new ticket
-    Ticket newTicket;
+    // Persist the whole session in one save; a ticket cancelled at another
+    // counter meanwhile was refunded, so report it instead of boarding it
+    if (accepted > 0) {
+        beginSharedUpdate();
+        for (int i = 0; i < count; i++) {
+            int ticketIndex = entries[i].ticketIndex;
+            if (boarded[i] != 2) {
+                continue;
+            }
+            if (tickets[ticketIndex].ticketID == entries[i].ticketID && tickets[ticketIndex].isActive == 1) {
+                tickets[ticketIndex].boarded = 1;
+            } else {
+                printf("Warning: Ticket %d was cancelled at another counter during boarding!\n",
+                       entries[i].ticketID);
+                cancelled++;
+            }
+        }
+        if (accepted > cancelled) {
+            saveTicketsToFile();
+        }
+        endSharedUpdate(accepted > cancelled);
+    }
     
-    // Generate unique ticket ID
-    newTicket.ticketID = ticketCount + 1;
-    for (int i = 0; i < ticketCount; i++) {
-        if (tickets[i].ticketID >= newTicket.ticketID) {
-            newTicket.ticketID = tickets[i].ticketID + 1;
+    printf("\n--- Boarding Summary ---\n");
+    printf("Scanned        : %d\n", scanned);
+    printf("Boarded        : %d\n", accepted - cancelled);
+    if (cancelled > 0) {
+        printf("Cancelled      : %d (boarded, but refunded at another counter)\n", cancelled);
+    }
+    printf("Duplicates     : %d\n", duplicates);
+    printf("Rejected       : %d\n", rejected);
+    printf("Not yet boarded: %d of %d\n", count - alreadyBoarded - accepted, count);
+    if (lookups > 0) {
+        printf("Average lookup : %.2f microseconds\n", lookupSeconds * 1e6 / lookups);
+    }
+}
+
+// Seconds from one monotonic time to another
+double secondsBetween(const struct timespec *from, const struct timespec *to) {
+    return (to->tv_sec - from->tv_sec) + (to->tv_nsec - from->tv_nsec) / 1e9;
+}
+
+// Make room for more bytes of operation input (returns 0 if out of memory)
+int reserveOperationInput(size_t length) {
+    if (length > 0x40000000u) {
+        return 0; // Only a damaged log has operations this large
+    }
+    if (operationInputLength + length > operationInputCapacity) {
+        unsigned int capacity = operationInputCapacity ? operationInputCapacity : 256;
+        while (capacity < operationInputLength + length) {
+            capacity *= 2;
+        }
+        char *grown = realloc(operationInput, capacity);
+        if (grown == NULL) {
+            return 0;
         }
+        operationInput = grown;
+        operationInputCapacity = capacity;
+    }
+    return 1;
+}
+
+// Add bytes to the current operation's input buffer (returns 0 if out of memory)
+int appendOperationInput(const char *data, size_t length) {
+    if (!reserveOperationInput(length)) {
+        return 0;
+    }
+    memcpy(operationInput + operationInputLength, data, length);
+    operationInputLength += length;
+    return 1;
+}
+
+// Read the keyboard for the program and keep a copy of every byte
+ssize_t captureRead(void *cookie, char *buffer, size_t size) {
+    ssize_t count = keyboardRead(cookie, buffer, size);
+    if (count > 0 && !appendOperationInput(buffer, count)) {
+        printf("Error: Not enough memory to capture input!\n");
+    }
+    return count;
+}
+
+// Hand out the current logged operation's input, then report end of input
+ssize_t replayRead(void *cookie, char *buffer, size_t size) {
+    (void)cookie;
+    size_t count = operationInputLength - operationInputPos;
+    if (count > size) {
+        count = size;
+    }
+    memcpy(buffer, operationInput + operationInputPos, count);
+    operationInputPos += count;
+    return count;
+}
+
+// Start logging every operation to a file
+int startCapture(const char *filename) {
+    captureLog = fopen(filename, "wb");
+    if (captureLog == NULL) {
+        printf("Error: Could not create operation log %s!\n", filename);
+        return 0;
     }
     
-    newTicket.tripID = tripID;
+    // The header is written again once the data files are counted
+    OperationLogHeader header = {OPLOG_MAGIC, OPLOG_VERSION, (long long)time(NULL), 0};
+    cookie_io_functions_t io = {captureRead, NULL, NULL, NULL};
+    FILE *input = fopencookie(NULL, "r", io);
+    if (input == NULL || fwrite(&header, sizeof(header), 1, captureLog) != 1 ||
+        (header.fileCount = snapshotDataFiles(captureLog)) < 0 ||
+        fseek(captureLog, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, captureLog) != 1 ||
+        fseek(captureLog, 0, SEEK_END) != 0) {
+        printf("Error: Could not start capturing to %s!\n", filename);
+        fclose(captureLog);
+        captureLog = NULL;
+        return 0;
+    }
     
-    // Get seat number
-    int seatNumber;
-    int validSeat = 0;
-    while (!validSeat) {
-        printf("Enter Seat Number (1-%d): ", trips[tripIndex].totalSeats);
-        scanf("%d", &seatNumber);
-        clearInputBuffer();
+    // Unbuffered, so each operation is logged with exactly the bytes it read
+    setvbuf(input, NULL, _IONBF, 0);
+    stdin = input;
+    clock_gettime(CLOCK_MONOTONIC, &operationStarted);
+    atexit(finishCapture);
+    return 1;
+}
+
+// Copy the data files into a capture log (returns how many, -1 on error)
+int snapshotDataFiles(FILE *log) {
+    const char *names[][2] = {
+        {"trips.txt", "trips.txt"}, {TRIP_JOURNAL_FILE, TRIP_JOURNAL_FILE},
+        {"tickets.txt", "tickets.txt"}, {"templates.txt", "templates.txt"},
+        {ARCHIVE_FILE, ARCHIVE_FILE}, {"waitlist.txt", waitlistFile}
+    };
+    int count = 0;
+    char buffer[65536];
+    
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        FILE *file = fopen(names[i][1], "rb");
+        struct stat info;
+        if (file == NULL) {
+            continue; // Not created yet
+        }
+        if (fstat(fileno(file), &info) != 0) {
+            fclose(file);
+            return -1;
+        }
         
-        // Validate seat number
-        if (seatNumber < 1 || seatNumber > trips[tripIndex].totalSeats) {
-            printf("Error: Invalid seat number! Please choose between 1 and %d.\n", trips[tripIndex].totalSeats);
-            continue;
+        OperationLogFile entry;
+        memset(&entry, 0, sizeof(entry));
+        snprintf(entry.name, sizeof(entry.name), "%s", names[i][0]);
+        entry.size = info.st_size;
+        if (fwrite(&entry, sizeof(entry), 1, log) != 1) {
+            fclose(file);
+            return -1;
         }
         
-        // Check if seat is already occupied
-        int isOccupied = 0;
-        for (int i = 0; i < ticketCount; i++) {
-            if (tickets[i].tripID == tripID && 
-                tickets[i].seatNumber == seatNumber && 
-                tickets[i].isActive == 1) {
-                isOccupied = 1;
-                break;
+        // Files are replaced whole, never rewritten, so the size holds
+        long long left = entry.size;
+        while (left > 0) {
+            size_t chunk = left < (long long)sizeof(buffer) ? (size_t)left : sizeof(buffer);
+            if (fread(buffer, 1, chunk, file) != chunk || fwrite(buffer, 1, chunk, log) != chunk) {
+                fclose(file);
+                return -1;
             }
+            left -= chunk;
+        }
+        fclose(file);
+        count++;
+    }
+    return count;
+}
+
+// Write the data files of a log into a new scratch directory and move
+// there, so a replay never touches the working files
+int restoreDataFiles(FILE *log, int fileCount) {
+    const char *tempDir = getenv("TMPDIR");
+    snprintf(replayDirectory, sizeof(replayDirectory), "%s/trip-replay-XXXXXX",
+             tempDir != NULL && tempDir[0] ? tempDir : "/tmp");
+    if (mkdtemp(replayDirectory) == NULL || chdir(replayDirectory) != 0) {
+        printf("Error: Could not create a directory for the replay!\n");
+        return 0;
+    }
+    
+    char buffer[65536];
+    for (int i = 0; i < fileCount; i++) {
+        OperationLogFile entry;
+        if (fread(&entry, sizeof(entry), 1, log) != 1 || entry.size < 0) {
+            return 0;
+        }
+        entry.name[OPLOG_FILE_NAME - 1] = '\0';
+        if (entry.name[0] == '\0' || entry.name[0] == '.' || strchr(entry.name, '/') != NULL) {
+            return 0;
         }
         
-        if (isOccupied) {
-            printf("Error: Seat %d is already occupied! Please choose another seat.\n", seatNumber);
-        } else {
-            validSeat = 1;
-            newTicket.seatNumber = seatNumber;
+        FILE *file = fopen(entry.name, "wb");
+        if (file == NULL) {
+            return 0;
+        }
+        long long left = entry.size;
+        while (left > 0) {
+            size_t chunk = left < (long long)sizeof(buffer) ? (size_t)left : sizeof(buffer);
+            if (fread(buffer, 1, chunk, log) != chunk || fwrite(buffer, 1, chunk, file) != chunk) {
+                fclose(file);
+                return 0;
+            }
+            left -= chunk;
+        }
+        if (fclose(file) != 0) {
+            return 0;
         }
     }
+    return 1;
+}
+
+// Start re-running the operations of a log, reading input from it. The
+// data files captured with the log are restored into a scratch directory
+// first; call this before any data is loaded.
+int startReplay(const char *filename) {
+    replayLog = fopen(filename, "rb");
+    if (replayLog == NULL) {
+        printf("Error: Could not open operation log %s!\n", filename);
+        return 0;
+    }
     
-    // Get passenger information
-    printf("\n--- Passenger Information ---\n");
+    OperationLogHeader header;
+    cookie_io_functions_t io = {replayRead, NULL, NULL, NULL};
+    FILE *input = NULL;
+    if (fread(&header, sizeof(header), 1, replayLog) != 1 ||
+        header.magic != OPLOG_MAGIC || header.version != OPLOG_VERSION ||
+        (input = fopencookie(NULL, "r", io)) == NULL) {
+        printf("Error: %s is not an operation log!\n", filename);
+        fclose(replayLog);
+        replayLog = NULL;
+        return 0;
+    }
+    if (!restoreDataFiles(replayLog, header.fileCount)) {
+        printf("Error: The data files in %s could not be restored!\n", filename);
+        fclose(input);
+        fclose(replayLog);
+        replayLog = NULL;
+        return 0;
+    }
+    replayStartTime = header.startTime;
+    fprintf(stderr, "Replaying on a copy of the captured data in %s\n", replayDirectory);
     
-    printf("Full Name: ");
-    fgets(newTicket.passenger.fullName, MAX_STRING, stdin);
-    newTicket.passenger.fullName[strcspn(newTicket.passenger.fullName, "\n")] = 0;
+    setvbuf(input, NULL, _IONBF, 0);
+    stdin = input;
+    clock_gettime(CLOCK_MONOTONIC, &replayStarted);
+    atexit(reportReplay);
+    return 1;
+}
+
+// Note the start of an operation once its menu choice is read
+void beginOperation(int choice) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
     
-    printf("ID Number (TC Kimlik): ");
-    fgets(newTicket.passenger.idNumber, MAX_STRING, stdin);
-    newTicket.passenger.idNumber[strcspn(newTicket.passenger.idNumber, "\n")] = 0;
+    if (captureLog != NULL) {
+        double delay = secondsBetween(&operationStarted, &now) * 1e6;
+        currentOperation.delayMicros = delay < 4294967295.0 ? (unsigned int)delay : 4294967295u;
+        operationPending = 1;
+    }
+    currentOperation.choice = choice;
+    operationStarted = now;
+}
+
+// Time the operation just finished (replay only)
+void endOperation() {
+    if (replayLog == NULL) {
+        return;
+    }
     
-    printf("Phone Number: ");
-    fgets(newTicket.passenger.phoneNumber, MAX_STRING, stdin);
-    newTicket.passenger.phoneNumber[strcspn(newTicket.passenger.phoneNumber, "\n")] = 0;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double seconds = secondsBetween(&operationStarted, &now);
     
-    printf("Email: ");
-    fgets(newTicket.passenger.email, MAX_STRING, stdin);
-    newTicket.passenger.email[strcspn(newTicket.passenger.email, "\n")] = 0;
+    if (replayCount == replayCapacity) {
+        int capacity = replayCapacity ? replayCapacity * 2 : 1024;
+        double *grown = realloc(replayLatencies, sizeof(double) * capacity);
+        if (grown == NULL) {
+            return;
+        }
+        replayLatencies = grown;
+        replayCapacity = capacity;
+    }
+    replayLatencies[replayCount++] = seconds;
     
-    // Set price and date
-    newTicket.price = trips[tripIndex].ticketPrice;
-    getCurrentDateTime(newTicket.purchaseDate, MAX_STRING);
-    newTicket.isActive = 1;
+    int choice = currentOperation.choice;
+    int kind = choice >= 0 && choice < OPERATION_KINDS - 1 ? choice : OPERATION_KINDS - 1;
+    replayKindCount[kind]++;
+    replayKindSeconds[kind] += seconds;
+}
+
+// Write the last operation and its input to the capture log. The input
+// ends with the Enter pressed after it, so this waits for the next menu.
+void writeCapturedOperation() {
+    if (captureLog == NULL || !operationPending) {
+        return;
+    }
     
-    // Add ticket to array
-    tickets[ticketCount] = newTicket;
-    ticketCount++;
+    currentOperation.inputLength = operationInputLength;
+    fwrite(&currentOperation, sizeof(currentOperation), 1, captureLog);
+    fwrite(operationInput, 1, operationInputLength, captureLog);
+    fflush(captureLog); // Keep the log usable if the program is killed
     
-    // Update trip available seats
-    trips[tripIndex].availableSeats--;
+    operationInputLength = 0;
+    operationPending = 0;
+}
+
+// Load the next logged operation's input and wait until it is due.
+// Returns 0 at the end of the log.
+int nextReplayOperation() {
+    OperationRecord record;
+    if (fread(&record, sizeof(record), 1, replayLog) != 1) {
+        return 0;
+    }
     
-    // Save to files
-    saveTicketsToFile();
-    saveTripsToFile();
+    // Input the previous operation left unread is dropped
+    operationInputLength = 0;
+    operationInputPos = 0;
+    clearerr(stdin);
     
-    printf("\n✓ Ticket sold successfully!\n");
-    printf("Ticket ID: %d\n", newTicket.ticketID);
-    printf("Passenger: %s\n", newTicket.passenger.fullName);
-    printf("Seat Number: %d\n", newTicket.seatNumber);
-    printf("Price: %.2f TL\n", newTicket.price);
+    if (!reserveOperationInput(record.inputLength) ||
+        fread(operationInput, 1, record.inputLength, replayLog) != record.inputLength) {
+        printf("Warning: The operation log ends in the middle of an operation.\n");
+        return 0;
+    }
+    operationInputLength = record.inputLength;
+    currentOperation = record;
+    replayClock += record.delayMicros / 1e6;
     
-    // Ask if user wants to create receipt
-    char createReceiptChoice;
-    printf("\nWould you like to create a receipt? (Y/N): ");
-    scanf(" %c", &createReceiptChoice);
-    clearInputBuffer();
+    // Keep the recorded gaps between operations
+    if (!replayFast) {
+        replayDue += record.delayMicros / 1e6;
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double wait = replayDue - secondsBetween(&replayStarted, &now);
+        if (wait > 0) {
+            struct timespec pause = {(time_t)wait, (long)((wait - (time_t)wait) * 1e9)};
+            nanosleep(&pause, NULL);
+        }
+    }
+    return 1;
+}
+
+// Save the operation in progress and close the capture log
+void finishCapture() {
+    writeCapturedOperation();
+    fclose(captureLog);
+    captureLog = NULL;
+}
+
+int compareLatencies(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Print throughput and latency of a replay (to stderr, so the program's
+// own output can be thrown away)
+void reportReplay() {
+    static const char *names[OPERATION_KINDS] = {
+        "Exit", "Create Trip", "Update Trip", "Delete Trip", "Trip Inquiry", "List All Trips",
+        "Sell Ticket", "Cancel Ticket", "Sell Group Tickets", "Hold Seat", "Find My Tickets",
+        "Search by Name", "Reports", "Bus/Driver Schedule", "Archive Departed Trips",
+        "Boarding Mode", "Plan Journey", "Recurring Trips", "Promote to Primary", "Invalid Choice"
+    };
     
-    if (createReceiptChoice == 'Y' || createReceiptChoice == 'y') {
-        createReceipt(newTicket.ticketID);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed = secondsBetween(&replayStarted, &now);
+    fflush(stdout);
+    
+    fprintf(stderr, "\n========================================\n");
+    fprintf(stderr, "           REPLAY REPORT\n");
+    fprintf(stderr, "========================================\n");
+    fprintf(stderr, "Pace           : %s\n", replayFast ? "maximum speed" : "as recorded");
+    fprintf(stderr, "Data copy      : %s\n", replayDirectory);
+    fprintf(stderr, "Operations     : %d\n", replayCount);
+    fprintf(stderr, "Elapsed        : %.3f seconds\n", elapsed);
+    if (replayCount == 0) {
+        return;
+    }
+    fprintf(stderr, "Throughput     : %.1f operations/second\n", elapsed > 0 ? replayCount / elapsed : 0.0);
+    
+    double total = 0;
+    for (int i = 0; i < replayCount; i++) {
+        total += replayLatencies[i];
+    }
+    qsort(replayLatencies, replayCount, sizeof(double), compareLatencies);
+    fprintf(stderr, "Latency (ms)   : avg %.3f  p50 %.3f  p95 %.3f  p99 %.3f  max %.3f\n",
+            total * 1e3 / replayCount,
+            replayLatencies[replayCount * 50 / 100] * 1e3,
+            replayLatencies[replayCount * 95 / 100] * 1e3,
+            replayLatencies[replayCount * 99 / 100] * 1e3,
+            replayLatencies[replayCount - 1] * 1e3);
+    
+    fprintf(stderr, "\n%-24s %-8s %-12s\n", "Operation", "Count", "Avg (ms)");
+    fprintf(stderr, "%-24s %-8s %-12s\n", "------------------------", "--------", "------------");
+    for (int kind = 0; kind < OPERATION_KINDS; kind++) {
+        if (replayKindCount[kind] > 0) {
+            fprintf(stderr, "%-24s %-8d %-12.3f\n", names[kind], replayKindCount[kind],
+                    replayKindSeconds[kind] * 1e3 / replayKindCount[kind]);
+        }
     }
 }
 
@@ -942,13 +7621,21 @@ void cancelTicket() {
         return;
     }
     
+    // A ticket that has been used cannot be refunded
+    if (tickets[ticketIndex].boarded) {
+        printf("Error: Ticket with ID %d has already been used for boarding!\n", ticketID);
+        return;
+    }
+    
     // Display ticket information
     printf("\n--- Ticket Information ---\n");
     printf("Ticket ID       : %d\n", tickets[ticketIndex].ticketID);
     printf("Trip ID         : %d\n", tickets[ticketIndex].tripID);
+    char stopNames[MAX_STOPS][MAX_STRING];
+    getTripStops(tripIndex, stopNames);
     printf("Route           : %s -> %s\n", 
-           trips[tripIndex].departurePoint, 
-           trips[tripIndex].arrivalPoint);
+           stopNames[tickets[ticketIndex].fromStop], 
+           stopNames[tickets[ticketIndex].toStop]);
     printf("Date            : %s at %s\n", 
            trips[tripIndex].tripDate, 
            trips[tripIndex].departureTime);
@@ -966,20 +7653,46 @@ void cancelTicket() {
     clearInputBuffer();
     
     if (confirm == 'Y' || confirm == 'y') {
+        beginSharedUpdate();
+        ticketIndex = findTicketByID(ticketID);
+        if (ticketIndex == -1 || findTripByID(tickets[ticketIndex].tripID) != tripIndex) {
+            printf("Error: Ticket with ID %d was just cancelled at another counter!\n", ticketID);
+            endSharedUpdate(0);
+            return;
+        }
+        if (tickets[ticketIndex].boarded) {
+            printf("Error: Ticket with ID %d was just used for boarding!\n", ticketID);
+            endSharedUpdate(0);
+            return;
+        }
+        
         // Mark ticket as inactive (cancelled)
+        unindexTicket(ticketIndex);
         tickets[ticketIndex].isActive = 0;
         
         // Increase available seats for the trip
-        trips[tripIndex].availableSeats++;
+        refreshAvailableSeats(tripIndex);
+        
+        // Hand the seat to the first waiting passenger, if any
+        int promoted = promoteFromWaitlist(tripIndex);
         
         // Save changes
         saveTicketsToFile();
         saveTripsToFile();
+        if (promoted > 0) {
+            saveWaitlistToFile();
+        }
+        endSharedUpdate(1);
         
         printf("\n✓ Ticket cancelled successfully!\n");
-        printf("Seat %d is now available for Trip ID %d.\n", 
-               tickets[ticketIndex].seatNumber, 
-               tickets[ticketIndex].tripID);
+        if (promoted > 0) {
+            printf("Seat %d was given to the first passenger on the waitlist.\n",
+                   tickets[ticketCount - 1].seatNumber);
+        } else {
+            printf("Seat %d is now available for Trip ID %d.\n", 
+                   tickets[ticketIndex].seatNumber, 
+                   tickets[ticketIndex].tripID);
+        }
         printf("Refund amount: %.2f TL\n", tickets[ticketIndex].price);
     } else {
         printf("\nCancellation aborted.\n");
@@ -1034,6 +7747,12 @@ void createReceipt(int ticketID) {
     fprintf(file, "Arrival Point    : %s\n", trips[tripIndex].arrivalPoint);
     fprintf(file, "Trip Date        : %s\n", trips[tripIndex].tripDate);
     fprintf(file, "Departure Time   : %s\n", trips[tripIndex].departureTime);
+    if (getStopCount(tripIndex) > 2) {
+        char stopNames[MAX_STOPS][MAX_STRING];
+        getTripStops(tripIndex, stopNames);
+        fprintf(file, "Boarding Stop    : %s\n", stopNames[tickets[ticketIndex].fromStop]);
+        fprintf(file, "Leaving Stop     : %s\n", stopNames[tickets[ticketIndex].toStop]);
+    }
     fprintf(file, "Seat Number      : %d\n", tickets[ticketIndex].seatNumber);
     fprintf(file, "\n");
     